@@ -0,0 +1,210 @@
+/*
+ * AdaptiveController.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "AdaptiveController.h"
+
+#include <cassert>
+#include <iostream>
+#include <algorithm>
+
+#include <boost/format.hpp>
+
+/**
+ * Frames the encoders have to sit comfortably below their budget before the
+ * levels are stepped back up, about two seconds at 30Hz
+ */
+static const int headroomSettleFrames = 60;
+
+AdaptiveController::AdaptiveController(CodecId depthCodec, int depthLevel, int depthMin, int depthMax,
+                                       CodecId imageCodec, int imageLevel, int imageMin, int imageMax,
+                                       int framesInFlight)
+ : depth(makeKnob(DepthStream, depthCodec, depthLevel, depthMin, depthMax)),
+   image(makeKnob(ImageStream, imageCodec, imageLevel, imageMin, imageMax)),
+   framesInFlight(framesInFlight),
+   averageEncodeTime(0),
+   averageFramePeriod(0),
+   lastTimestamp(0),
+   lastDroppedFrames(0),
+   framesSinceChange(0),
+   headroomFrames(0)
+{
+    assert(framesInFlight > 0);
+}
+
+AdaptiveController::Knob AdaptiveController::makeKnob(CodecStream stream, CodecId id, int level, int minLevel, int maxLevel)
+{
+    const CodecInfo * info = CodecRegistry::find(stream, id);
+
+    assert(info);
+
+    Knob knob;
+
+    knob.codec = info;
+    knob.minLevel = minLevel == -1 ? info->minLevel : std::max(minLevel, info->minLevel);
+    knob.maxLevel = maxLevel == -1 ? info->maxLevel : std::min(maxLevel, info->maxLevel);
+    knob.level = std::min(std::max(level == -1 ? info->defaultLevel : level, knob.minLevel), knob.maxLevel);
+
+    /**
+     * Roughly ten steps across the codec's whole range, so JPEG moves in
+     * quality steps of 10 and zlib one level at a time
+     */
+    knob.step = std::max(1, (info->maxLevel - info->minLevel + 9) / 10);
+
+    return knob;
+}
+
+bool AdaptiveController::stepKnob(Knob & knob, bool faster)
+{
+    int level = knob.level + knob.codec->fasterStep * knob.step * (faster ? 1 : -1);
+
+    level = std::min(std::max(level, knob.minLevel), knob.maxLevel);
+
+    if(level == knob.level)
+    {
+        return false;
+    }
+
+    knob.level = level;
+
+    return true;
+}
+
+void AdaptiveController::frameEncoded(int64_t timestamp, int64_t encodeTime)
+{
+    /**
+     * Timestamps are time of day, skip the gap at midnight or after a stall
+     */
+    int64_t period = timestamp - lastTimestamp;
+
+    if(lastTimestamp && period > 0 && period < 1000000)
+    {
+        averageFramePeriod = averageFramePeriod == 0 ? period : averageFramePeriod * 0.8 + period * 0.2;
+    }
+
+    lastTimestamp = timestamp;
+
+    averageEncodeTime = averageEncodeTime == 0 ? encodeTime : averageEncodeTime * 0.8 + encodeTime * 0.2;
+}
+
+bool AdaptiveController::update(uint64_t sequence, int backlog, int droppedFrames)
+{
+    framesSinceChange++;
+
+    bool lost = droppedFrames > lastDroppedFrames;
+
+    lastDroppedFrames = droppedFrames;
+
+    /**
+     * A frame can spend up to framesInFlight frame periods in the encoders
+     * before the writer runs out of buffers and the ring starts lapping it
+     */
+    double budget = averageFramePeriod * framesInFlight;
+
+    bool behind = lost ||
+                  (framesInFlight > 1 && backlog >= framesInFlight - 1) ||
+                  (budget > 0 && averageEncodeTime > budget * 0.8);
+
+    bool headroom = !behind &&
+                    backlog <= framesInFlight / 2 &&
+                    budget > 0 &&
+                    averageEncodeTime < budget * 0.4;
+
+    headroomFrames = headroom ? headroomFrames + 1 : 0;
+
+    /**
+     * Frames already in flight were dispatched at the old levels, wait for
+     * them to drain before judging a change
+     */
+    if(framesSinceChange < framesInFlight * 2)
+    {
+        return false;
+    }
+
+    bool faster;
+    const char * reason;
+
+    if(behind)
+    {
+        faster = true;
+        reason = lost ? "frames dropped" : "encoders behind";
+    }
+    else if(headroomFrames >= headroomSettleFrames)
+    {
+        faster = false;
+        reason = "encoders have headroom";
+    }
+    else
+    {
+        return false;
+    }
+
+    int previousDepth = depth.level;
+    int previousImage = image.level;
+
+    bool changed = false;
+
+    if(stepKnob(depth, faster))
+    {
+        queueChange(sequence, depth, previousDepth, reason);
+        changed = true;
+    }
+
+    if(stepKnob(image, faster))
+    {
+        queueChange(sequence, image, previousImage, reason);
+        changed = true;
+    }
+
+    if(changed)
+    {
+        framesSinceChange = 0;
+        headroomFrames = 0;
+    }
+
+    return changed;
+}
+
+void AdaptiveController::queueChange(uint64_t sequence, const Knob & knob, int previous, const char * reason)
+{
+    Change change;
+
+    change.sequence = sequence;
+    change.codec = knob.codec;
+    change.previous = previous;
+    change.level = knob.level;
+    change.reason = reason;
+    change.encodeTime = averageEncodeTime;
+    change.framePeriod = averageFramePeriod;
+
+    changes.push_back(change);
+}
+
+void AdaptiveController::frameWritten(uint64_t sequence, int32_t recordIndex)
+{
+    /**
+     * Frames are written in sequence order, if the frame a change was made
+     * for was dropped it applies from the next one written
+     */
+    while(!changes.empty() && changes.front().sequence <= sequence)
+    {
+        const Change & change = changes.front();
+
+        std::cout << boost::format("%s %s level %d -> %d from record %d (device frame %d): %s (encode %.1fms, frame period %.1fms)")
+                     % (change.codec->stream == DepthStream ? "Depth" : "Image")
+                     % change.codec->name
+                     % change.previous
+                     % change.level
+                     % recordIndex
+                     % change.sequence
+                     % change.reason
+                     % (change.encodeTime / 1000.0)
+                     % (change.framePeriod / 1000.0)
+                     << std::endl;
+
+        changes.pop_front();
+    }
+}
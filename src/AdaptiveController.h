@@ -0,0 +1,119 @@
+/*
+ * AdaptiveController.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef ADAPTIVECONTROLLER_H_
+#define ADAPTIVECONTROLLER_H_
+
+#include <stdint.h>
+
+#include <deque>
+
+#include "CodecRegistry.h"
+
+/**
+ * Trades compression ratio for encoder throughput. The writer reports every
+ * frame it dispatches and every frame that finishes encoding, the controller
+ * steps the depth and image codec levels towards faster settings when the
+ * encoders fall behind and back towards smaller output when they have
+ * headroom, never leaving the bounds it was given
+ */
+class AdaptiveController
+{
+    public:
+        struct Knob
+        {
+            const CodecInfo * codec;
+            int level;
+            int minLevel;
+            int maxLevel;
+            int step;
+        };
+
+        /**
+         * Levels of -1 pick the codec's default, bounds of -1 its full range
+         */
+        AdaptiveController(CodecId depthCodec, int depthLevel, int depthMin, int depthMax,
+                           CodecId imageCodec, int imageLevel, int imageMin, int imageMax,
+                           int framesInFlight);
+
+        /**
+         * Called by the writer for each frame that finished encoding, with its
+         * capture timestamp and the time from dispatch to the last job
+         * finishing, both in microseconds
+         */
+        void frameEncoded(int64_t timestamp, int64_t encodeTime);
+
+        /**
+         * Called before the frame with the given sequence is dispatched, with
+         * the number of frames still being encoded and the number of frames
+         * dropped so far. Returns true if the levels the frame should use
+         * differ from the previous frame's. The change is logged once the
+         * first frame using it is written, see frameWritten()
+         */
+        bool update(uint64_t sequence, int backlog, int droppedFrames);
+
+        /**
+         * Called by the writer for each frame record it writes, with the
+         * frame's sequence and the record's index in the log. Logs every
+         * change that the record is the first to be encoded with
+         */
+        void frameWritten(uint64_t sequence, int32_t recordIndex);
+
+        int getDepthLevel() const
+        {
+            return depth.level;
+        }
+
+        int getImageLevel() const
+        {
+            return image.level;
+        }
+
+    private:
+        static Knob makeKnob(CodecStream stream, CodecId id, int level, int minLevel, int maxLevel);
+
+        /**
+         * Moves the knob one step, faster or slower, returns false if it is
+         * already at that bound
+         */
+        static bool stepKnob(Knob & knob, bool faster);
+
+        /**
+         * A level change, kept until the first frame dispatched with it is
+         * written. Frames in flight at the time may still be dropped, so
+         * only then is its index in the log known
+         */
+        struct Change
+        {
+            uint64_t sequence;
+            const CodecInfo * codec;
+            int previous;
+            int level;
+            const char * reason;
+            double encodeTime;
+            double framePeriod;
+        };
+
+        void queueChange(uint64_t sequence, const Knob & knob, int previous, const char * reason);
+
+        Knob depth;
+        Knob image;
+
+        std::deque<Change> changes;
+
+        int framesInFlight;
+
+        double averageEncodeTime;
+        double averageFramePeriod;
+        int64_t lastTimestamp;
+
+        int lastDroppedFrames;
+        int framesSinceChange;
+        int headroomFrames;
+};
+
+#endif /* ADAPTIVECONTROLLER_H_ */
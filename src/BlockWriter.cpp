@@ -0,0 +1,643 @@
+/*
+ * BlockWriter.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "BlockWriter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#else
+#include "KlgFormat.h"
+#endif
+
+#include <algorithm>
+
+BlockWriter::BlockWriter()
+ :
+#ifdef __linux__
+   fd(-1),
+   patchFd(-1),
+#else
+   file(0),
+#endif
+   direct(false),
+   async(false),
+   ok(false),
+   blockSize(0),
+   maxBlocks(1),
+   current(0),
+   used(0),
+   blockOffset(0),
+   preallocateSize(0),
+   preallocatedEnd(0),
+   writesInProgress(0)
+{
+    memset(&stats, 0, sizeof(Stats));
+}
+
+BlockWriter::~BlockWriter()
+{
+    close();
+}
+
+bool BlockWriter::open(const std::string & filename, int blockSize, int64_t backlogSize, int64_t preallocateSize, bool direct)
+{
+    close();
+
+    this->blockSize = (std::max(blockSize, 1) + Alignment - 1) / Alignment * Alignment;
+    this->preallocateSize = std::max(preallocateSize, (int64_t)0);
+    this->direct = direct;
+
+    if(!openFile(filename))
+    {
+        return false;
+    }
+
+    /**
+     * The block being filled plus the backlog. io_uring may be missing
+     * from the kernel or blocked, then every block is written in place
+     */
+    maxBlocks = 1 + std::max(backlogSize, (int64_t)0) / this->blockSize;
+    async = false;
+
+#ifdef WITH_LIBURING
+    async = maxBlocks > 1 && io_uring_queue_init(maxBlocks, &ring, 0) == 0;
+#endif
+
+    if(!async)
+    {
+        maxBlocks = 1;
+    }
+
+    used = 0;
+    blockOffset = 0;
+    preallocatedEnd = 0;
+    writesInProgress = 0;
+    ok = true;
+
+    memset(&stats, 0, sizeof(Stats));
+
+    current = takeBlock();
+
+    if(!current)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool BlockWriter::close()
+{
+    if(!isOpen())
+    {
+        return false;
+    }
+
+    int64_t end = tell();
+
+    if(current && used > 0)
+    {
+        /**
+         * O_DIRECT only takes whole aligned blocks, the padding is cut off
+         * again below
+         */
+        size_t length = direct ? (used + Alignment - 1) / Alignment * Alignment : used;
+
+        memset(current->data + used, 0, length - used);
+
+        submitBlock(current, length);
+    }
+
+    waitFor(end);
+
+    if(preallocatedEnd > end)
+    {
+        releaseSpace(end, preallocatedEnd - end);
+    }
+
+    if(!truncateFile(end))
+    {
+        ok = false;
+    }
+
+#ifdef WITH_LIBURING
+    if(async)
+    {
+        io_uring_queue_exit(&ring);
+    }
+#endif
+
+    closeFile();
+
+    async = false;
+
+    for(size_t i = 0; i < blocks.size(); i++)
+    {
+        free(blocks[i]->data);
+        delete blocks[i];
+    }
+
+    blocks.clear();
+    idle.clear();
+    pending.clear();
+
+    current = 0;
+    used = 0;
+
+    return ok;
+}
+
+bool BlockWriter::write(const void * data, size_t size)
+{
+    if(!isOpen() || !current)
+    {
+        return false;
+    }
+
+    const uint8_t * bytes = (const uint8_t *)data;
+
+    while(size > 0)
+    {
+        size_t chunk = std::min(size, blockSize - used);
+
+        memcpy(current->data + used, bytes, chunk);
+
+        used += chunk;
+        bytes += chunk;
+        size -= chunk;
+
+        if(used == blockSize)
+        {
+            submitBlock(current, blockSize);
+
+            blockOffset += blockSize;
+            used = 0;
+
+            current = takeBlock();
+
+            if(!current)
+            {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    return ok;
+}
+
+bool BlockWriter::patch(int64_t offset, const void * data, size_t size)
+{
+    if(!isOpen() || !current || offset < 0 || offset + (int64_t)size > tell())
+    {
+        return false;
+    }
+
+    const uint8_t * bytes = (const uint8_t *)data;
+
+    /**
+     * Whatever falls in the block still being filled goes out with it,
+     * the rest is either in the file or on its way there
+     */
+    if(offset + (int64_t)size > blockOffset)
+    {
+        int64_t start = std::max(offset, blockOffset);
+
+        memcpy(current->data + (start - blockOffset), bytes + (start - offset), offset + size - start);
+
+        size = std::max(blockOffset - offset, (int64_t)0);
+    }
+
+    if(size > 0)
+    {
+        waitFor(offset + size);
+
+        if(!writeAt(true, bytes, size, offset))
+        {
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+BlockWriter::Block * BlockWriter::takeBlock()
+{
+    reap(false);
+
+    while(idle.empty())
+    {
+        if(blocks.size() < maxBlocks)
+        {
+            uint8_t * memory = allocateBlock();
+
+            if(memory)
+            {
+                Block * block = new Block;
+
+                block->data = memory;
+
+                blocks.push_back(block);
+                idle.push_back(block);
+
+                break;
+            }
+
+            /**
+             * Make do with the blocks there are
+             */
+            maxBlocks = blocks.size();
+        }
+
+        if(pending.empty())
+        {
+            return 0;
+        }
+
+        reap(true);
+    }
+
+    Block * block = idle.back();
+
+    idle.pop_back();
+
+    return block;
+}
+
+void BlockWriter::submitBlock(Block * block, size_t length)
+{
+    block->offset = blockOffset;
+    block->length = length;
+    block->done = 0;
+    block->complete = false;
+    block->submitted = boost::posix_time::microsec_clock::local_time();
+
+    pending.push_back(block);
+
+    stats.peakBacklog = std::max(stats.peakBacklog, block->offset + (int64_t)length - flushedOffset());
+
+    preallocate(block->offset + length);
+
+    writeStarted();
+
+#ifdef WITH_LIBURING
+    if(async)
+    {
+        queueWrite(block);
+        return;
+    }
+#endif
+
+    writeBlock(block);
+
+    stats.blockedMicroseconds += (boost::posix_time::microsec_clock::local_time() - block->submitted).total_microseconds();
+
+    finishBlock(block);
+}
+
+void BlockWriter::writeBlock(Block * block)
+{
+    if(ok && block->done < block->length)
+    {
+        if(writeAt(false, block->data + block->done, block->length - block->done, block->offset + block->done))
+        {
+            block->done = block->length;
+        }
+        else
+        {
+            ok = false;
+        }
+    }
+}
+
+void BlockWriter::finishBlock(Block * block)
+{
+    int64_t elapsed = (boost::posix_time::microsec_clock::local_time() - block->submitted).total_microseconds();
+
+    block->complete = true;
+
+    stats.bytes += block->done;
+    stats.writes++;
+    stats.longestWrite = std::max(stats.longestWrite, elapsed);
+
+    if(elapsed > StallMicroseconds)
+    {
+        stats.stalls++;
+    }
+
+    writeFinished();
+
+    /**
+     * Blocks can complete out of order, the file is only known to be
+     * written up to the oldest one still in flight
+     */
+    while(!pending.empty() && pending.front()->complete)
+    {
+        idle.push_back(pending.front());
+        pending.pop_front();
+    }
+}
+
+#ifdef WITH_LIBURING
+void BlockWriter::queueWrite(Block * block)
+{
+    io_uring_sqe * sqe = io_uring_get_sqe(&ring);
+
+    /**
+     * Can't happen with one entry per block, but if it does the block
+     * just goes out in place
+     */
+    if(!sqe)
+    {
+        writeBlock(block);
+        finishBlock(block);
+        return;
+    }
+
+    io_uring_prep_write(sqe, fd, block->data + block->done, block->length - block->done, block->offset + block->done);
+    io_uring_sqe_set_data(sqe, block);
+
+    io_uring_submit(&ring);
+}
+#endif
+
+void BlockWriter::reap(bool wait)
+{
+#ifdef WITH_LIBURING
+    if(!async)
+    {
+        return;
+    }
+
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+
+    /**
+     * Waits for one completion at most, then takes whatever else is ready.
+     * Whenever anything is pending its oldest block is in flight
+     */
+    while(!pending.empty())
+    {
+        io_uring_cqe * cqe;
+
+        int result = wait ? io_uring_wait_cqe(&ring, &cqe) : io_uring_peek_cqe(&ring, &cqe);
+
+        if(result == -EINTR)
+        {
+            continue;
+        }
+
+        if(result < 0)
+        {
+            if(wait)
+            {
+                /**
+                 * The ring itself is broken, nothing pending is coming back
+                 */
+                ok = false;
+
+                while(!pending.empty())
+                {
+                    finishBlock(pending.front());
+                }
+            }
+
+            break;
+        }
+
+        wait = false;
+
+        Block * block = (Block *)io_uring_cqe_get_data(cqe);
+        int written = cqe->res;
+
+        io_uring_cqe_seen(&ring, cqe);
+
+        if(written == -EINTR || written == -EAGAIN)
+        {
+            queueWrite(block);
+        }
+        else if(written <= 0)
+        {
+            ok = false;
+            finishBlock(block);
+        }
+        else
+        {
+            block->done += written;
+
+            /**
+             * Short writes are resubmitted for the rest
+             */
+            if(block->done < block->length)
+            {
+                queueWrite(block);
+            }
+            else
+            {
+                finishBlock(block);
+            }
+        }
+    }
+
+    stats.blockedMicroseconds += (boost::posix_time::microsec_clock::local_time() - start).total_microseconds();
+#endif
+}
+
+void BlockWriter::waitFor(int64_t offset)
+{
+    while(!pending.empty() && flushedOffset() < offset)
+    {
+        reap(true);
+    }
+}
+
+void BlockWriter::preallocate(int64_t end)
+{
+    /**
+     * KEEP_SIZE so a recording that is cut short doesn't end in a run of
+     * zeros. File systems without fallocate just grow the file as before
+     */
+    while(preallocateSize > 0 && preallocatedEnd < end)
+    {
+        if(!reserveSpace(preallocatedEnd, preallocateSize))
+        {
+            preallocateSize = 0;
+            break;
+        }
+
+        preallocatedEnd += preallocateSize;
+    }
+}
+
+void BlockWriter::writeStarted()
+{
+    if(writesInProgress++ == 0)
+    {
+        busySince = boost::posix_time::microsec_clock::local_time();
+    }
+}
+
+void BlockWriter::writeFinished()
+{
+    if(--writesInProgress == 0)
+    {
+        stats.writeMicroseconds += (boost::posix_time::microsec_clock::local_time() - busySince).total_microseconds();
+    }
+}
+
+#ifdef __linux__
+bool BlockWriter::openFile(const std::string & filename)
+{
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | (direct ? O_DIRECT : 0), 0644);
+
+    if(fd < 0 && direct && errno == EINVAL)
+    {
+        direct = false;
+
+        fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    /**
+     * Small unaligned patches can't go through an O_DIRECT descriptor
+     */
+    patchFd = direct && fd >= 0 ? ::open(filename.c_str(), O_WRONLY) : fd;
+
+    if(fd < 0 || patchFd < 0)
+    {
+        closeFile();
+        return false;
+    }
+
+    return true;
+}
+
+void BlockWriter::closeFile()
+{
+    if(patchFd >= 0 && patchFd != fd)
+    {
+        ::close(patchFd);
+    }
+
+    if(fd >= 0)
+    {
+        ::close(fd);
+    }
+
+    fd = -1;
+    patchFd = -1;
+}
+
+bool BlockWriter::isOpen() const
+{
+    return fd >= 0;
+}
+
+bool BlockWriter::writeAt(bool patching, const void * data, size_t size, int64_t offset)
+{
+    const uint8_t * bytes = (const uint8_t *)data;
+
+    while(size > 0)
+    {
+        ssize_t written = pwrite(patching ? patchFd : fd, bytes, size, offset);
+
+        if(written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if(written <= 0)
+        {
+            return false;
+        }
+
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+
+    return true;
+}
+
+bool BlockWriter::truncateFile(int64_t size)
+{
+    return ftruncate(fd, size) == 0;
+}
+
+bool BlockWriter::reserveSpace(int64_t offset, int64_t length)
+{
+    return fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, length) == 0;
+}
+
+void BlockWriter::releaseSpace(int64_t offset, int64_t length)
+{
+    fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length);
+}
+
+uint8_t * BlockWriter::allocateBlock()
+{
+    void * memory = 0;
+
+    return posix_memalign(&memory, Alignment, blockSize) == 0 ? (uint8_t *)memory : 0;
+}
+#else
+/**
+ * Plain buffered stdio, without O_DIRECT or preallocation
+ */
+bool BlockWriter::openFile(const std::string & filename)
+{
+    direct = false;
+    preallocateSize = 0;
+
+    file = fopen(filename.c_str(), "wb");
+
+    return file != 0;
+}
+
+void BlockWriter::closeFile()
+{
+    if(file && fclose(file) != 0)
+    {
+        ok = false;
+    }
+
+    file = 0;
+}
+
+bool BlockWriter::isOpen() const
+{
+    return file != 0;
+}
+
+bool BlockWriter::writeAt(bool patching, const void * data, size_t size, int64_t offset)
+{
+    return klgSeek(file, offset, SEEK_SET) == 0 && fwrite(data, 1, size, file) == size;
+}
+
+bool BlockWriter::truncateFile(int64_t size)
+{
+    return fflush(file) == 0 && klgTruncate(file, size);
+}
+
+bool BlockWriter::reserveSpace(int64_t offset, int64_t length)
+{
+    return false;
+}
+
+void BlockWriter::releaseSpace(int64_t offset, int64_t length)
+{
+}
+
+uint8_t * BlockWriter::allocateBlock()
+{
+    return (uint8_t *)malloc(blockSize);
+}
+#endif
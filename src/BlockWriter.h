@@ -0,0 +1,192 @@
+/*
+ * BlockWriter.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef BLOCKWRITER_H_
+#define BLOCKWRITER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#ifdef WITH_LIBURING
+#include <liburing.h>
+#endif
+
+/**
+ * Sequential file output that gathers everything written into large
+ * aligned blocks and only touches the file a whole block at a time, at
+ * block aligned offsets. Space is reserved ahead of the writes in big
+ * extents with fallocate, so the file system isn't extending the file
+ * on every write. Optionally bypasses the page cache with O_DIRECT.
+ * Preallocation and O_DIRECT are Linux only, elsewhere the blocks are
+ * written through stdio.
+ *
+ * Built with liburing, full blocks are queued to io_uring and written
+ * while the next ones fill, up to a backlog of blocks, so a disk that
+ * stalls now and then holds up the caller only once the backlog is full.
+ * Otherwise, or without a backlog, each block is written with pwrite
+ * before write() returns
+ */
+class BlockWriter : public boost::noncopyable
+{
+    public:
+        /**
+         * Alignment of the block buffers, block sizes and, with O_DIRECT,
+         * of every write
+         */
+        static const int Alignment = 4096;
+
+        /**
+         * Block writes taking longer than this count as stalls
+         */
+        static const int StallMicroseconds = 50 * 1000;
+
+        /**
+         * writeMicroseconds is the time any block write was in progress,
+         * blockedMicroseconds the part of it the caller spent waiting
+         */
+        struct Stats
+        {
+            int64_t bytes;
+            int64_t writes;
+            int64_t writeMicroseconds;
+            int64_t blockedMicroseconds;
+            int64_t longestWrite;
+            int64_t stalls;
+            int64_t peakBacklog;
+        };
+
+        BlockWriter();
+        virtual ~BlockWriter();
+
+        /**
+         * blockSize is rounded up to the alignment. Up to backlogSize bytes
+         * of full blocks may be waiting on the disk, 0 writes each block
+         * synchronously. A preallocateSize of 0 doesn't reserve space. If
+         * the file system refuses O_DIRECT the file is written through the
+         * page cache instead, see isDirect()
+         */
+        bool open(const std::string & filename, int blockSize, int64_t backlogSize, int64_t preallocateSize, bool direct);
+
+        /**
+         * Writes out what is left of the last block, waits for every write
+         * and cuts the file to what was written, dropping any padding and
+         * unused reservation. Returns false if any write failed since open()
+         */
+        bool close();
+
+        bool write(const void * data, size_t size);
+
+        /**
+         * Overwrites bytes already written, whether or not their block has
+         * gone out yet. For small fixups such as the frame count
+         */
+        bool patch(int64_t offset, const void * data, size_t size);
+
+        /**
+         * Bytes written so far, and how many of them are in the file
+         */
+        int64_t tell() const
+        {
+            return blockOffset + used;
+        }
+
+        int64_t flushedOffset() const
+        {
+            return pending.empty() ? blockOffset : pending.front()->offset;
+        }
+
+        bool isDirect() const
+        {
+            return direct;
+        }
+
+        /**
+         * Whether blocks are written in the background
+         */
+        bool isAsync() const
+        {
+            return async;
+        }
+
+        const Stats & getStats() const
+        {
+            return stats;
+        }
+
+    private:
+        struct Block
+        {
+            uint8_t * data;
+            int64_t offset;
+            size_t length;
+            size_t done;
+            bool complete;
+            boost::posix_time::ptime submitted;
+        };
+
+        Block * takeBlock();
+        void submitBlock(Block * block, size_t length);
+        void writeBlock(Block * block);
+        void finishBlock(Block * block);
+        void reap(bool wait);
+        void waitFor(int64_t offset);
+        void preallocate(int64_t end);
+        void writeStarted();
+        void writeFinished();
+
+        bool openFile(const std::string & filename);
+        void closeFile();
+        bool isOpen() const;
+        bool writeAt(bool patching, const void * data, size_t size, int64_t offset);
+        bool truncateFile(int64_t size);
+        bool reserveSpace(int64_t offset, int64_t length);
+        void releaseSpace(int64_t offset, int64_t length);
+        uint8_t * allocateBlock();
+
+#ifdef __linux__
+        int fd;
+        int patchFd;
+#else
+        FILE * file;
+#endif
+        bool direct;
+        bool async;
+        bool ok;
+
+        size_t blockSize;
+        size_t maxBlocks;
+        std::vector<Block *> blocks;
+        std::vector<Block *> idle;
+        std::deque<Block *> pending;
+
+        Block * current;
+        size_t used;
+        int64_t blockOffset;
+
+        int64_t preallocateSize;
+        int64_t preallocatedEnd;
+
+        int writesInProgress;
+        boost::posix_time::ptime busySince;
+        Stats stats;
+
+#ifdef WITH_LIBURING
+        io_uring ring;
+
+        void queueWrite(Block * block);
+#endif
+};
+
+#endif /* BLOCKWRITER_H_ */
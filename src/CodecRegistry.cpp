@@ -0,0 +1,772 @@
+/*
+ * CodecRegistry.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "CodecRegistry.h"
+
+#include <zlib.h>
+
+#include <cstring>
+#include <algorithm>
+
+#include "DepthCompressor.h"
+#include "JpegEncoder.h"
+#include "RvlCodec.h"
+
+#include <jerror.h>
+
+#ifdef WITH_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef WITH_PNG
+#include <png.h>
+#endif
+
+namespace
+{
+    class ZlibDepthEncoder : public DepthEncoder
+    {
+        public:
+            ZlibDepthEncoder(int level)
+             : compressor(level)
+            {}
+
+            int bound(int numPixels)
+            {
+                return compressor.bound(numPixels * sizeof(uint16_t));
+            }
+
+            int encode(const uint16_t * depth, int numPixels, uint8_t * output, int capacity)
+            {
+                return compressor.compress(reinterpret_cast<const uint8_t *>(depth), numPixels * sizeof(uint16_t), output, capacity);
+            }
+
+            void setLevel(int level)
+            {
+                compressor.setLevel(level);
+            }
+
+        private:
+            DepthCompressor compressor;
+    };
+
+    class RvlDepthEncoder : public DepthEncoder
+    {
+        public:
+            int bound(int numPixels)
+            {
+                return RvlCodec::bound(numPixels);
+            }
+
+            int encode(const uint16_t * depth, int numPixels, uint8_t * output, int capacity)
+            {
+                return capacity < bound(numPixels) ? -1 : RvlCodec::encode(depth, numPixels, output);
+            }
+    };
+
+    class RawDepthEncoder : public DepthEncoder
+    {
+        public:
+            int bound(int numPixels)
+            {
+                return numPixels * sizeof(uint16_t);
+            }
+
+            int encode(const uint16_t * depth, int numPixels, uint8_t * output, int capacity)
+            {
+                if(capacity < bound(numPixels))
+                {
+                    return -1;
+                }
+
+                memcpy(output, depth, numPixels * sizeof(uint16_t));
+
+                return numPixels * sizeof(uint16_t);
+            }
+    };
+
+#ifdef WITH_LZ4
+    /**
+     * Level is LZ4's acceleration factor, higher is faster and larger
+     */
+    class Lz4DepthEncoder : public DepthEncoder
+    {
+        public:
+            Lz4DepthEncoder(int level)
+             : acceleration(level)
+            {}
+
+            int bound(int numPixels)
+            {
+                return LZ4_compressBound(numPixels * sizeof(uint16_t));
+            }
+
+            int encode(const uint16_t * depth, int numPixels, uint8_t * output, int capacity)
+            {
+                int size = LZ4_compress_fast(reinterpret_cast<const char *>(depth), reinterpret_cast<char *>(output), numPixels * sizeof(uint16_t), capacity, acceleration);
+
+                return size > 0 ? size : -1;
+            }
+
+            void setLevel(int level)
+            {
+                acceleration = level;
+            }
+
+        private:
+            int acceleration;
+    };
+#endif
+
+#ifdef WITH_ZSTD
+    class ZstdDepthEncoder : public DepthEncoder
+    {
+        public:
+            ZstdDepthEncoder(int level)
+             : context(ZSTD_createCCtx()),
+               level(level)
+            {}
+
+            virtual ~ZstdDepthEncoder()
+            {
+                ZSTD_freeCCtx(context);
+            }
+
+            int bound(int numPixels)
+            {
+                return ZSTD_compressBound(numPixels * sizeof(uint16_t));
+            }
+
+            int encode(const uint16_t * depth, int numPixels, uint8_t * output, int capacity)
+            {
+                size_t size = ZSTD_compressCCtx(context, output, capacity, depth, numPixels * sizeof(uint16_t), level);
+
+                return ZSTD_isError(size) ? -1 : (int)size;
+            }
+
+            void setLevel(int level)
+            {
+                this->level = level;
+            }
+
+        private:
+            ZSTD_CCtx * context;
+            int level;
+    };
+#endif
+
+    class RawImageEncoder : public ImageEncoder
+    {
+        public:
+            int encode(const uint8_t * pixels, int width, int height, int channels, int rowStride, std::vector<uint8_t> & output)
+            {
+                int rowBytes = width * channels;
+
+                if(output.size() < (size_t)rowBytes * height)
+                {
+                    output.resize(rowBytes * height);
+                }
+
+                for(int i = 0; i < height; i++)
+                {
+                    memcpy(&output[i * rowBytes], pixels + i * rowStride, rowBytes);
+                }
+
+                return rowBytes * height;
+            }
+    };
+
+    /**
+     * Each byte is stored as its difference (mod 256) from the same channel
+     * of the pixel to its left, then the whole image is deflated as one
+     * stream. A GRBG Bayer plane passed as 2 channel pixels is predicted from
+     * the nearest sample of the same colour
+     */
+    class ZlibImageEncoder : public ImageEncoder
+    {
+        public:
+            ZlibImageEncoder(int level)
+             : compressor(level)
+            {}
+
+            int encode(const uint8_t * pixels, int width, int height, int channels, int rowStride, std::vector<uint8_t> & output)
+            {
+                int rowBytes = width * channels;
+
+                if(filtered.size() < (size_t)rowBytes * height)
+                {
+                    filtered.resize(rowBytes * height);
+                }
+
+                for(int i = 0; i < height; i++)
+                {
+                    const uint8_t * src = pixels + i * rowStride;
+                    uint8_t * dst = &filtered[i * rowBytes];
+
+                    memcpy(dst, src, channels);
+
+                    for(int j = channels; j < rowBytes; j++)
+                    {
+                        dst[j] = src[j] - src[j - channels];
+                    }
+                }
+
+                int bound = compressor.bound(rowBytes * height);
+
+                if(output.size() < (size_t)bound)
+                {
+                    output.resize(bound);
+                }
+
+                return compressor.compress(&filtered[0], rowBytes * height, &output[0], output.size());
+            }
+
+            void setLevel(int level)
+            {
+                compressor.setLevel(level);
+            }
+
+        private:
+            DepthCompressor compressor;
+            std::vector<uint8_t> filtered;
+    };
+
+    struct JpegErrorManager
+    {
+        jpeg_error_mgr pub;
+        jmp_buf jump;
+    };
+
+    void jpegErrorExit(j_common_ptr cinfo)
+    {
+        longjmp(reinterpret_cast<JpegErrorManager *>(cinfo->err)->jump, 1);
+    }
+
+    void jpegInitSource(j_decompress_ptr cinfo)
+    {}
+
+    /**
+     * The whole image is in memory, running out means it was truncated
+     */
+    boolean jpegFillInputBuffer(j_decompress_ptr cinfo)
+    {
+        ERREXIT(cinfo, JERR_INPUT_EOF);
+
+        return FALSE;
+    }
+
+    void jpegSkipInputData(j_decompress_ptr cinfo, long numBytes)
+    {
+        if(numBytes > (long)cinfo->src->bytes_in_buffer)
+        {
+            ERREXIT(cinfo, JERR_INPUT_EOF);
+        }
+
+        if(numBytes > 0)
+        {
+            cinfo->src->next_input_byte += numBytes;
+            cinfo->src->bytes_in_buffer -= numBytes;
+        }
+    }
+
+    void jpegTermSource(j_decompress_ptr cinfo)
+    {}
+
+    /**
+     * Only 3 channel images are JPEG encoded, read in as BGR like
+     * JpegEncoder takes them, so this gives back the bytes it was given
+     */
+    bool decodeJpeg(const uint8_t * input, int size, uint8_t * pixels, int width, int height, int channels)
+    {
+        if(channels != 3)
+        {
+            return false;
+        }
+
+        jpeg_decompress_struct cinfo;
+        JpegErrorManager errorManager;
+        jpeg_source_mgr source;
+
+        cinfo.err = jpeg_std_error(&errorManager.pub);
+        errorManager.pub.error_exit = &jpegErrorExit;
+
+        if(setjmp(errorManager.jump))
+        {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+
+        jpeg_create_decompress(&cinfo);
+
+        source.next_input_byte = input;
+        source.bytes_in_buffer = size;
+        source.init_source = &jpegInitSource;
+        source.fill_input_buffer = &jpegFillInputBuffer;
+        source.skip_input_data = &jpegSkipInputData;
+        source.resync_to_restart = &jpeg_resync_to_restart;
+        source.term_source = &jpegTermSource;
+
+        cinfo.src = &source;
+
+        if(jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK ||
+           (int)cinfo.image_width != width ||
+           (int)cinfo.image_height != height ||
+           cinfo.num_components != 3)
+        {
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+
+#ifdef JCS_EXTENSIONS
+        cinfo.out_color_space = JCS_EXT_BGR;
+#else
+        cinfo.out_color_space = JCS_RGB;
+#endif
+
+        jpeg_start_decompress(&cinfo);
+
+        while(cinfo.output_scanline < cinfo.output_height)
+        {
+            JSAMPROW row = pixels + cinfo.output_scanline * width * 3;
+
+            jpeg_read_scanlines(&cinfo, &row, 1);
+
+#ifndef JCS_EXTENSIONS
+            for(int j = 0; j < width * 3; j += 3)
+            {
+                std::swap(row[j], row[j + 2]);
+            }
+#endif
+        }
+
+        jpeg_finish_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+
+        return true;
+    }
+
+    /**
+     * Undoes ZlibImageEncoder's left neighbour prediction
+     */
+    bool decodeZlibImage(const uint8_t * input, int size, uint8_t * pixels, int width, int height, int channels)
+    {
+        int rowBytes = width * channels;
+        uLongf length = rowBytes * height;
+
+        if(uncompress(pixels, &length, input, size) != Z_OK || length != (uLongf)rowBytes * height)
+        {
+            return false;
+        }
+
+        for(int i = 0; i < height; i++)
+        {
+            uint8_t * row = pixels + i * rowBytes;
+
+            for(int j = channels; j < rowBytes; j++)
+            {
+                row[j] += row[j - channels];
+            }
+        }
+
+        return true;
+    }
+
+#ifdef WITH_PNG
+    struct PngSource
+    {
+        const uint8_t * input;
+        size_t size;
+        size_t offset;
+    };
+
+    void pngRead(png_structp png, png_bytep data, png_size_t length)
+    {
+        PngSource * source = static_cast<PngSource *>(png_get_io_ptr(png));
+
+        if(length > source->size - source->offset)
+        {
+            png_error(png, "truncated");
+        }
+
+        memcpy(data, source->input + source->offset, length);
+        source->offset += length;
+    }
+
+    /**
+     * 3 channel images are read back swapped, as PngImageEncoder stored them
+     */
+    bool decodePng(const uint8_t * input, int size, uint8_t * pixels, int width, int height, int channels)
+    {
+        static const int colourTypes[] = {PNG_COLOR_TYPE_GRAY, PNG_COLOR_TYPE_GRAY_ALPHA, PNG_COLOR_TYPE_RGB};
+
+        if(channels < 1 || channels > 3)
+        {
+            return false;
+        }
+
+        png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
+        png_infop info = png ? png_create_info_struct(png) : 0;
+
+        if(!info)
+        {
+            png_destroy_read_struct(&png, 0, 0);
+            return false;
+        }
+
+        std::vector<png_bytep> rows(height);
+        PngSource source = {input, (size_t)size, 0};
+
+        if(setjmp(png_jmpbuf(png)))
+        {
+            png_destroy_read_struct(&png, &info, 0);
+            return false;
+        }
+
+        png_set_read_fn(png, &source, &pngRead);
+        png_read_info(png, info);
+
+        if((int)png_get_image_width(png, info) != width ||
+           (int)png_get_image_height(png, info) != height ||
+           png_get_bit_depth(png, info) != 8 ||
+           png_get_color_type(png, info) != colourTypes[channels - 1] ||
+           png_get_interlace_type(png, info) != PNG_INTERLACE_NONE)
+        {
+            png_destroy_read_struct(&png, &info, 0);
+            return false;
+        }
+
+        if(channels == 3)
+        {
+            png_set_bgr(png);
+        }
+
+        for(int i = 0; i < height; i++)
+        {
+            rows[i] = pixels + i * width * channels;
+        }
+
+        png_read_image(png, &rows[0]);
+        png_read_end(png, 0);
+        png_destroy_read_struct(&png, &info, 0);
+
+        return true;
+    }
+
+    /**
+     * libpng can't reuse its write struct across images, so unlike the other
+     * codecs this one allocates per frame. 3 channel images are stored
+     * swapped for the same reason as in JpegEncoder, OpenCV decodes them back
+     * in order
+     */
+    class PngImageEncoder : public ImageEncoder
+    {
+        public:
+            PngImageEncoder(int level)
+             : level(level)
+            {}
+
+            int encode(const uint8_t * pixels, int width, int height, int channels, int rowStride, std::vector<uint8_t> & output)
+            {
+                if(channels < 1 || channels > 3)
+                {
+                    return -1;
+                }
+
+                static const int colourTypes[] = {PNG_COLOR_TYPE_GRAY, PNG_COLOR_TYPE_GRAY_ALPHA, PNG_COLOR_TYPE_RGB};
+
+                png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
+                png_infop info = png ? png_create_info_struct(png) : 0;
+
+                if(!info)
+                {
+                    png_destroy_write_struct(&png, 0);
+                    return -1;
+                }
+
+                if(rows.size() < (size_t)height)
+                {
+                    rows.resize(height);
+                }
+
+                Sink sink = {&output, 0};
+
+                if(setjmp(png_jmpbuf(png)))
+                {
+                    png_destroy_write_struct(&png, &info);
+                    return -1;
+                }
+
+                png_set_write_fn(png, &sink, &PngImageEncoder::write, &PngImageEncoder::flush);
+                png_set_compression_level(png, level);
+                png_set_filter(png, 0, PNG_FILTER_SUB);
+                png_set_IHDR(png, info, width, height, 8, colourTypes[channels - 1], PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+                png_write_info(png, info);
+
+                if(channels == 3)
+                {
+                    png_set_bgr(png);
+                }
+
+                for(int i = 0; i < height; i++)
+                {
+                    rows[i] = const_cast<png_bytep>(pixels + i * rowStride);
+                }
+
+                png_write_image(png, &rows[0]);
+                png_write_end(png, 0);
+                png_destroy_write_struct(&png, &info);
+
+                return sink.size;
+            }
+
+            void setLevel(int level)
+            {
+                this->level = level;
+            }
+
+        private:
+            struct Sink
+            {
+                std::vector<uint8_t> * output;
+                size_t size;
+            };
+
+            static void write(png_structp png, png_bytep data, png_size_t length)
+            {
+                Sink * sink = static_cast<Sink *>(png_get_io_ptr(png));
+
+                if(sink->output->size() < sink->size + length)
+                {
+                    sink->output->resize((sink->size + length) * 2);
+                }
+
+                memcpy(&(*sink->output)[sink->size], data, length);
+                sink->size += length;
+            }
+
+            static void flush(png_structp png)
+            {}
+
+            std::vector<png_bytep> rows;
+            int level;
+    };
+#endif
+}
+
+const std::vector<CodecInfo> & CodecRegistry::codecs()
+{
+    static std::vector<CodecInfo> codecs;
+
+    if(codecs.empty())
+    {
+        CodecInfo zlib = {CodecZlib, DepthStream, "zlib", 1, 1, 9, -1};
+        CodecInfo rvl = {CodecRvl, DepthStream, "rvl", 0, 0, 0, -1};
+        CodecInfo rawDepth = {CodecRaw, DepthStream, "raw", 0, 0, 0, -1};
+        CodecInfo jpeg = {CodecJpeg, ImageStream, "jpeg", 90, 1, 100, -1};
+        CodecInfo rawImage = {CodecRaw, ImageStream, "raw", 0, 0, 0, -1};
+        CodecInfo zlibImage = {CodecZlib, ImageStream, "zlib", 1, 1, 9, -1};
+
+        codecs.push_back(zlib);
+        codecs.push_back(rvl);
+        codecs.push_back(rawDepth);
+#ifdef WITH_LZ4
+        CodecInfo lz4 = {CodecLz4, DepthStream, "lz4", 1, 1, 64, 1};
+        codecs.push_back(lz4);
+#endif
+#ifdef WITH_ZSTD
+        CodecInfo zstd = {CodecZstd, DepthStream, "zstd", 1, 1, 19, -1};
+        codecs.push_back(zstd);
+#endif
+        codecs.push_back(jpeg);
+#ifdef WITH_PNG
+        CodecInfo png = {CodecPng, ImageStream, "png", 1, 0, 9, -1};
+        codecs.push_back(png);
+#endif
+        codecs.push_back(zlibImage);
+        codecs.push_back(rawImage);
+    }
+
+    return codecs;
+}
+
+const CodecInfo * CodecRegistry::find(CodecStream stream, const std::string & name)
+{
+    const std::vector<CodecInfo> & all = codecs();
+
+    for(size_t i = 0; i < all.size(); i++)
+    {
+        if(all[i].stream == stream && name == all[i].name)
+        {
+            return &all[i];
+        }
+    }
+
+    return 0;
+}
+
+const CodecInfo * CodecRegistry::find(CodecStream stream, CodecId id)
+{
+    const std::vector<CodecInfo> & all = codecs();
+
+    for(size_t i = 0; i < all.size(); i++)
+    {
+        if(all[i].stream == stream && all[i].id == id)
+        {
+            return &all[i];
+        }
+    }
+
+    return 0;
+}
+
+DepthEncoder * CodecRegistry::createDepthEncoder(CodecId id, int level)
+{
+    const CodecInfo * info = find(DepthStream, id);
+
+    if(!info)
+    {
+        return 0;
+    }
+
+    if(level == -1)
+    {
+        level = info->defaultLevel;
+    }
+
+    switch(id)
+    {
+        case CodecZlib:
+            return new ZlibDepthEncoder(level);
+        case CodecRvl:
+            return new RvlDepthEncoder;
+        case CodecRaw:
+            return new RawDepthEncoder;
+#ifdef WITH_LZ4
+        case CodecLz4:
+            return new Lz4DepthEncoder(level);
+#endif
+#ifdef WITH_ZSTD
+        case CodecZstd:
+            return new ZstdDepthEncoder(level);
+#endif
+        default:
+            return 0;
+    }
+}
+
+bool CodecRegistry::decodeDepth(CodecId id, const uint8_t * input, int size, uint16_t * depth, int numPixels)
+{
+    int bytes = numPixels * sizeof(uint16_t);
+
+    if(size < 0)
+    {
+        return false;
+    }
+
+    switch(id)
+    {
+        case CodecZlib:
+        {
+            uLongf length = bytes;
+
+            return uncompress(reinterpret_cast<Bytef *>(depth), &length, input, size) == Z_OK && length == (uLongf)bytes;
+        }
+        case CodecRvl:
+            return RvlCodec::decode(input, size, depth, numPixels);
+        case CodecRaw:
+            if(size != bytes)
+            {
+                return false;
+            }
+
+            memcpy(depth, input, bytes);
+
+            return true;
+#ifdef WITH_LZ4
+        case CodecLz4:
+            return LZ4_decompress_safe(reinterpret_cast<const char *>(input), reinterpret_cast<char *>(depth), size, bytes) == bytes;
+#endif
+#ifdef WITH_ZSTD
+        case CodecZstd:
+        {
+            size_t length = ZSTD_decompress(depth, bytes, input, size);
+
+            return !ZSTD_isError(length) && length == (size_t)bytes;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+bool CodecRegistry::decodeImage(CodecId id, const uint8_t * input, int size, uint8_t * pixels, int width, int height, int channels)
+{
+    int bytes = width * height * channels;
+
+    if(size <= 0 || width <= 0 || height <= 0)
+    {
+        return false;
+    }
+
+    switch(id)
+    {
+        case CodecJpeg:
+            return decodeJpeg(input, size, pixels, width, height, channels);
+#ifdef WITH_PNG
+        case CodecPng:
+            return decodePng(input, size, pixels, width, height, channels);
+#endif
+        case CodecZlib:
+            return decodeZlibImage(input, size, pixels, width, height, channels);
+        case CodecRaw:
+            if(size != bytes)
+            {
+                return false;
+            }
+
+            memcpy(pixels, input, bytes);
+
+            return true;
+        default:
+            return false;
+    }
+}
+
+ImageEncoder * CodecRegistry::createImageEncoder(CodecId id, int level)
+{
+    const CodecInfo * info = find(ImageStream, id);
+
+    if(!info)
+    {
+        return 0;
+    }
+
+    if(level == -1)
+    {
+        level = info->defaultLevel;
+    }
+
+    switch(id)
+    {
+        case CodecJpeg:
+            return new JpegEncoder(level);
+#ifdef WITH_PNG
+        case CodecPng:
+            return new PngImageEncoder(level);
+#endif
+        case CodecZlib:
+            return new ZlibImageEncoder(level);
+        case CodecRaw:
+            return new RawImageEncoder;
+        default:
+            return 0;
+    }
+}
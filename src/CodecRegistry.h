@@ -0,0 +1,134 @@
+/*
+ * CodecRegistry.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef CODECREGISTRY_H_
+#define CODECREGISTRY_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+/**
+ * Codec ids are written to .klg files, never renumber them
+ */
+enum CodecId
+{
+    CodecZlib = 0,
+    CodecRvl = 1,
+    CodecRaw = 2,
+    CodecLz4 = 3,
+    CodecZstd = 4,
+    CodecJpeg = 5,
+    CodecPng = 6
+};
+
+enum CodecStream
+{
+    DepthStream,
+    ImageStream
+};
+
+/**
+ * Compresses runs of 16 bit depth pixels. Instances belong to one encoder
+ * worker and are reused from frame to frame
+ */
+class DepthEncoder : public boost::noncopyable
+{
+    public:
+        virtual ~DepthEncoder()
+        {}
+
+        /**
+         * Worst case output size in bytes for numPixels input pixels
+         */
+        virtual int bound(int numPixels) = 0;
+
+        /**
+         * Returns the number of bytes written to output, or -1 on failure
+         */
+        virtual int encode(const uint16_t * depth, int numPixels, uint8_t * output, int capacity) = 0;
+
+        virtual void setLevel(int level)
+        {}
+};
+
+/**
+ * Compresses packed 8 bit images of 1 to 3 channels. Instances belong to
+ * one encoder worker and are reused from frame to frame
+ */
+class ImageEncoder : public boost::noncopyable
+{
+    public:
+        virtual ~ImageEncoder()
+        {}
+
+        /**
+         * Encodes into output, growing it if needed, and returns the encoded
+         * length or -1 on failure, including for channel counts the codec
+         * can't store
+         */
+        virtual int encode(const uint8_t * pixels, int width, int height, int channels, int rowStride, std::vector<uint8_t> & output) = 0;
+
+        virtual void setLevel(int level)
+        {}
+};
+
+struct CodecInfo
+{
+    CodecId id;
+    CodecStream stream;
+    const char * name;
+    int defaultLevel;
+    int minLevel;
+    int maxLevel;
+    /**
+     * Level change that makes the codec faster, -1 for most codecs but +1
+     * for LZ4 where the level is an acceleration factor
+     */
+    int fasterStep;
+};
+
+/**
+ * Every codec compiled into this build, looked up by name (for the command
+ * line) or by id (as stored in files)
+ */
+class CodecRegistry
+{
+    public:
+        static const std::vector<CodecInfo> & codecs();
+
+        static const CodecInfo * find(CodecStream stream, const std::string & name);
+        static const CodecInfo * find(CodecStream stream, CodecId id);
+
+        /**
+         * level of -1 picks the codec's default. Returns 0 for codecs of the
+         * wrong stream or that are not compiled in
+         */
+        static DepthEncoder * createDepthEncoder(CodecId id, int level = -1);
+        static ImageEncoder * createImageEncoder(CodecId id, int level = -1);
+
+        /**
+         * Decodes size bytes written by the depth codec id into exactly
+         * numPixels pixels. Returns false if the data is corrupt, decodes to
+         * a different size, or the codec is not compiled in
+         */
+        static bool decodeDepth(CodecId id, const uint8_t * input, int size, uint16_t * depth, int numPixels);
+
+        /**
+         * Decodes size bytes written by the image codec id back into the
+         * packed image of width x height pixels of channels bytes that was
+         * given to ImageEncoder::encode(), in the same byte order. Returns
+         * false if the data is corrupt, holds a different image size or
+         * channel count, or the codec is not compiled in
+         */
+        static bool decodeImage(CodecId id, const uint8_t * input, int size, uint8_t * pixels, int width, int height, int channels);
+};
+
+#endif /* CODECREGISTRY_H_ */
@@ -0,0 +1,208 @@
+/*
+ * DebayerTest.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "OpenNI/openni_image_bayer_grbg.h"
+#include "OpenNI/openni_simd.h"
+
+static const char * instructionSetNames[] = {"scalar", "SSE2", "SSSE3", "AVX2"};
+static const char * methodNames[] = {"Bilinear", "EdgeAware", "EdgeAwareWeighted"};
+
+static const int numPatterns = 4;
+static const unsigned char canary = 0xA5;
+
+static void fillPattern(std::vector<unsigned char> & bayer, unsigned width, int pattern)
+{
+    for(size_t i = 0; i < bayer.size(); i++)
+    {
+        unsigned x = i % width;
+        unsigned y = i / width;
+
+        switch(pattern)
+        {
+            case 0:
+                bayer[i] = rand() & 255;
+                break;
+            case 1:
+                bayer[i] = (x * 7 + y * 3) & 255;
+                break;
+            case 2:
+                bayer[i] = ((x / 5 + y / 7) & 1) * 255;
+                break;
+            default:
+                /**
+                 * Near saturation, where a wrong rounding or an overflowing
+                 * sum shows up
+                 */
+                bayer[i] = x > width / 2 ? 252 + (rand() & 3) : rand() & 3;
+                break;
+        }
+    }
+}
+
+static void debayer(const boost::shared_ptr<xn::ImageMetaData> & bayerData,
+                    openni_wrapper::ImageBayerGRBG::DebayeringMethod method,
+                    openni_wrapper::simd::InstructionSet instructionSet,
+                    unsigned width,
+                    unsigned height,
+                    unsigned lineStep,
+                    std::vector<unsigned char> & rgb)
+{
+    openni_wrapper::simd::setInstructionSet(instructionSet);
+
+    openni_wrapper::ImageBayerGRBG image(bayerData, method);
+
+    rgb.assign(lineStep * height, canary);
+
+    image.fillRGB(width, height, &rgb[0], lineStep);
+}
+
+/**
+ * Runs the kernel alone on the second pair of rows for each odd pixel
+ * count that fits, checking the pixels it wrote against the scalar output
+ * and that everything after them is untouched
+ */
+static int checkKernel(openni_wrapper::simd::DebayerRowKernel kernel,
+                       const std::vector<unsigned char> & bayer,
+                       unsigned width,
+                       unsigned lineStep,
+                       const std::vector<unsigned char> & expected)
+{
+    int failures = 0;
+    std::vector<unsigned char> rgb;
+
+    for(unsigned pixels = 1; pixels <= width - 4; pixels += 2)
+    {
+        rgb.assign(expected.size(), canary);
+
+        unsigned done = kernel(&bayer[2 * width + 2], width, &rgb[2 * lineStep + 6], lineStep, pixels);
+
+        bool good = done <= pixels && done % 2 == 0;
+
+        for(unsigned row = 2; good && row < 4; row++)
+        {
+            const unsigned char * out = &rgb[row * lineStep];
+
+            good = memcmp(out + 6, &expected[row * lineStep + 6], done * 3) == 0;
+
+            for(unsigned i = 6 + done * 3; good && i < lineStep; i++)
+            {
+                good = out[i] == canary;
+            }
+        }
+
+        if(!good)
+        {
+            std::cout << boost::format("  kernel for %d of %d pixels wrote %d\n") % pixels % width % done;
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+/**
+ * Checks that the SIMD debayer kernels give exactly the output of the
+ * scalar code, for every debayering method and every instruction set both
+ * this build and the CPU have. Widths are stepped through every remainder
+ * of the vector widths, the output rows are padded, and each kernel is
+ * also called directly with odd pixel counts to check it never writes
+ * past what it reports. Exits with 1 on any failure
+ */
+int main()
+{
+    openni_wrapper::simd::InstructionSet best = openni_wrapper::simd::detectInstructionSet();
+
+    std::cout << boost::format("Checking debayer kernels up to %s\n") % instructionSetNames[best];
+
+    std::vector<std::pair<unsigned, unsigned> > sizes;
+
+    for(unsigned width = 6; width <= 72; width += 2)
+    {
+        sizes.push_back(std::make_pair(width, 10u));
+    }
+
+    sizes.push_back(std::make_pair(102u, 38u));
+    sizes.push_back(std::make_pair(640u, 480u));
+    sizes.push_back(std::make_pair(1280u, 1024u));
+
+    int failures = 0;
+
+    std::vector<unsigned char> bayer;
+    std::vector<unsigned char> expected;
+    std::vector<unsigned char> rgb;
+
+    srand(1);
+
+    for(size_t s = 0; s < sizes.size(); s++)
+    {
+        unsigned width = sizes[s].first;
+        unsigned height = sizes[s].second;
+
+        bayer.resize(width * height);
+
+        boost::shared_ptr<xn::ImageMetaData> bayerData(new xn::ImageMetaData);
+
+        for(int pattern = 0; pattern < numPatterns; pattern++)
+        {
+            fillPattern(bayer, width, pattern);
+
+            bayerData->ReAdjust(width, height, XN_PIXEL_FORMAT_GRAYSCALE_8_BIT, &bayer[0]);
+
+            for(int padding = 0; padding <= 5; padding += 5)
+            {
+                unsigned lineStep = width * 3 + padding;
+
+                for(int m = openni_wrapper::ImageBayerGRBG::Bilinear; m <= openni_wrapper::ImageBayerGRBG::EdgeAwareWeighted; m++)
+                {
+                    openni_wrapper::ImageBayerGRBG::DebayeringMethod method = (openni_wrapper::ImageBayerGRBG::DebayeringMethod)m;
+
+                    debayer(bayerData, method, openni_wrapper::simd::Scalar, width, height, lineStep, expected);
+
+                    for(int i = openni_wrapper::simd::SSE2; i <= best; i++)
+                    {
+                        openni_wrapper::simd::InstructionSet instructionSet = (openni_wrapper::simd::InstructionSet)i;
+
+                        const openni_wrapper::simd::Kernels * kernels = openni_wrapper::simd::getKernels(instructionSet);
+
+                        if(!kernels || !kernels->debayer[m])
+                        {
+                            continue;
+                        }
+
+                        debayer(bayerData, method, instructionSet, width, height, lineStep, rgb);
+
+                        int kernelFailures = rgb == expected ? 0 : 1;
+
+                        if(width <= 102)
+                        {
+                            kernelFailures += checkKernel(kernels->debayer[m], bayer, width, lineStep, expected);
+                        }
+
+                        if(kernelFailures)
+                        {
+                            std::cout << boost::format("FAIL %s %s %dx%d line step %d pattern %d\n") % instructionSetNames[i] % methodNames[m] % width % height % lineStep % pattern;
+                            failures += kernelFailures;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << boost::format("%d failures\n") % failures;
+
+    return failures == 0 ? 0 : 1;
+}
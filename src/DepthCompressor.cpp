@@ -0,0 +1,66 @@
+/*
+ * DepthCompressor.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "DepthCompressor.h"
+
+#include <new>
+#include <cstring>
+
+DepthCompressor::DepthCompressor(int level)
+ : level(level),
+   streamLevel(level)
+{
+    memset(&stream, 0, sizeof(stream));
+
+    if(deflateInit(&stream, level) != Z_OK)
+    {
+        throw std::bad_alloc();
+    }
+}
+
+DepthCompressor::~DepthCompressor()
+{
+    deflateEnd(&stream);
+}
+
+unsigned long DepthCompressor::bound(unsigned long sourceSize)
+{
+    return deflateBound(&stream, sourceSize);
+}
+
+void DepthCompressor::setLevel(int level)
+{
+    this->level = level;
+}
+
+int DepthCompressor::compress(const uint8_t * src, unsigned long sourceSize, uint8_t * dst, unsigned long dstCapacity)
+{
+    deflateReset(&stream);
+
+    stream.next_in = const_cast<Bytef *>(src);
+    stream.avail_in = sourceSize;
+    stream.next_out = dst;
+    stream.avail_out = dstCapacity;
+
+    /**
+     * Older zlibs flush with deflate(Z_BLOCK) inside deflateParams, which
+     * after the reset writes the stream header. So the level is only
+     * changed once the output points at this frame's buffer, where that
+     * header belongs anyway
+     */
+    if(streamLevel != level && deflateParams(&stream, level, Z_DEFAULT_STRATEGY) == Z_OK)
+    {
+        streamLevel = level;
+    }
+
+    if(deflate(&stream, Z_FINISH) != Z_STREAM_END)
+    {
+        return -1;
+    }
+
+    return stream.total_out;
+}
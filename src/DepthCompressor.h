@@ -0,0 +1,56 @@
+/*
+ * DepthCompressor.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef DEPTHCOMPRESSOR_H_
+#define DEPTHCOMPRESSOR_H_
+
+#include <zlib.h>
+#include <stdint.h>
+
+#include <boost/noncopyable.hpp>
+
+/**
+ * zlib compressor that keeps its deflate state alive between frames and
+ * only resets it, instead of paying deflateInit/deflateEnd per frame like
+ * compress2 does. Output is a plain zlib stream, same as compress2
+ */
+class DepthCompressor : public boost::noncopyable
+{
+    public:
+        DepthCompressor(int level = Z_BEST_SPEED);
+        virtual ~DepthCompressor();
+
+        /**
+         * Worst case output size for sourceSize input bytes
+         */
+        unsigned long bound(unsigned long sourceSize);
+
+        /**
+         * Returns the number of bytes written to dst, or -1 if dstCapacity
+         * was too small
+         */
+        int compress(const uint8_t * src, unsigned long sourceSize, uint8_t * dst, unsigned long dstCapacity);
+
+        void setLevel(int level);
+
+        int getLevel() const
+        {
+            return level;
+        }
+
+    private:
+        z_stream stream;
+        int level;
+
+        /**
+         * The level the stream was last set to, level is applied from the
+         * next compress() on
+         */
+        int streamLevel;
+};
+
+#endif /* DEPTHCOMPRESSOR_H_ */
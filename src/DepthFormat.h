@@ -0,0 +1,91 @@
+/*
+ * DepthFormat.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef DEPTHFORMAT_H_
+#define DEPTHFORMAT_H_
+
+#include <stdint.h>
+
+#include "CodecRegistry.h"
+
+enum DepthFrameType
+{
+    DepthFrameKey = 0,
+    DepthFrameDelta = 1
+};
+
+/**
+ * Depth payloads that are not plain zlib start with this header. A zlib
+ * stream always begins with 0x78, which can never be the first byte of
+ * depthPayloadMagic, so readers can tell the two apart from the first
+ * byte and old files stay valid. headerSize is the offset of the codec
+ * data, so fields can be appended later without breaking readers
+ */
+struct DepthPayloadHeader
+{
+    uint32_t magic;
+    uint16_t headerSize;
+    uint8_t codec;
+    uint8_t frameType;
+    uint16_t width;
+    uint16_t height;
+    /**
+     * Index in the file of the keyframe this frame's chain starts from
+     */
+    uint32_t keyframeIndex;
+    /**
+     * The frame is split into this many horizontal stripes, stripe i
+     * covering rows [i * height / stripes, (i + 1) * height / stripes).
+     * A table of stripes uint32_t compressed sizes directly follows the
+     * fixed header fields (and is included in headerSize), then the stripes
+     * in order, each compressed on its own so they can be decoded in
+     * parallel. Delta frames are striped the same way
+     */
+    uint16_t stripes;
+    uint16_t reserved;
+};
+
+/**
+ * A DepthFrameDelta frame stores, per pixel and in 16 bit arithmetic,
+ * zigzag(current - previous) where previous is the frame written just
+ * before it, so small changes of either sign become small codes
+ */
+inline uint16_t depthResidual(uint16_t current, uint16_t previous)
+{
+    int16_t delta = (int16_t)(current - previous);
+
+    return (uint16_t)((delta << 1) ^ (delta >> 15));
+}
+
+inline uint16_t depthFromResidual(uint16_t residual, uint16_t previous)
+{
+    int16_t delta = (int16_t)((residual >> 1) ^ -(int16_t)(residual & 1));
+
+    return (uint16_t)(previous + delta);
+}
+
+static const uint32_t depthPayloadMagic = 0x4850444b; // "KDPH"
+
+inline void initDepthPayloadHeader(DepthPayloadHeader & header, CodecId codec, DepthFrameType frameType, int width, int height, int stripes)
+{
+    header.magic = depthPayloadMagic;
+    header.headerSize = sizeof(DepthPayloadHeader) + stripes * sizeof(uint32_t);
+    header.codec = codec;
+    header.frameType = frameType;
+    header.width = width;
+    header.height = height;
+    header.keyframeIndex = 0;
+    header.stripes = stripes;
+    header.reserved = 0;
+}
+
+inline bool isDepthPayloadHeader(const uint8_t * payload, int size)
+{
+    return size >= (int)sizeof(DepthPayloadHeader) && reinterpret_cast<const DepthPayloadHeader *>(payload)->magic == depthPayloadMagic;
+}
+
+#endif /* DEPTHFORMAT_H_ */
@@ -0,0 +1,80 @@
+/*
+ * EncoderPool.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "EncoderPool.h"
+
+#include <cassert>
+
+EncoderPool::EncoderPool(int numThreads)
+ : quit(false)
+{
+    assert(numThreads > 0);
+
+    for(int i = 0; i < numThreads; i++)
+    {
+        scratch.push_back(new EncoderScratch);
+        threads.add_thread(new boost::thread(boost::bind(&EncoderPool::workerLoop, this, scratch.back())));
+    }
+}
+
+EncoderPool::~EncoderPool()
+{
+    boost::mutex::scoped_lock lock(mutex);
+
+    quit = true;
+
+    jobReady.notify_all();
+
+    lock.unlock();
+
+    threads.join_all();
+
+    for(size_t i = 0; i < scratch.size(); i++)
+    {
+        delete scratch[i];
+    }
+}
+
+void EncoderPool::submit(const Job & job)
+{
+    boost::mutex::scoped_lock lock(mutex);
+
+    jobs.push_back(job);
+
+    jobReady.notify_one();
+
+    lock.unlock();
+}
+
+void EncoderPool::workerLoop(EncoderScratch * workerScratch)
+{
+    while(true)
+    {
+        boost::mutex::scoped_lock lock(mutex);
+
+        while(jobs.empty() && !quit)
+        {
+            jobReady.wait(lock);
+        }
+
+        /**
+         * Outstanding jobs are always run so nobody waits forever on them
+         */
+        if(jobs.empty())
+        {
+            return;
+        }
+
+        Job job = jobs.front();
+
+        jobs.pop_front();
+
+        lock.unlock();
+
+        job(*workerScratch);
+    }
+}
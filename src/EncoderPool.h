@@ -0,0 +1,69 @@
+/*
+ * EncoderPool.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef ENCODERPOOL_H_
+#define ENCODERPOOL_H_
+
+#include <deque>
+#include <vector>
+
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <boost/scoped_ptr.hpp>
+
+#include "CodecRegistry.h"
+#include "OpenNI/openni_image_bayer_grbg.h"
+
+/**
+ * Encoder state owned by a single worker thread and reused across jobs.
+ * The encoders are created by the first job that needs them
+ */
+struct EncoderScratch
+{
+    boost::scoped_ptr<DepthEncoder> depthEncoder;
+    boost::scoped_ptr<ImageEncoder> imageEncoder;
+    std::vector<uint16_t> depthResidual;
+    /**
+     * Wraps a ring slot's Bayer mosaic so it can be debayered on the worker
+     */
+    boost::shared_ptr<xn::ImageMetaData> bayerData;
+    boost::shared_ptr<openni_wrapper::ImageBayerGRBG> bayerImage;
+};
+
+/**
+ * Fixed set of long-lived encoder threads pulling jobs from a FIFO queue
+ */
+class EncoderPool : public boost::noncopyable
+{
+    public:
+        typedef boost::function<void (EncoderScratch &)> Job;
+
+        EncoderPool(int numThreads);
+        virtual ~EncoderPool();
+
+        void submit(const Job & job);
+
+        int size() const
+        {
+            return scratch.size();
+        }
+
+    private:
+        void workerLoop(EncoderScratch * workerScratch);
+
+        boost::mutex mutex;
+        boost::condition_variable jobReady;
+        std::deque<Job> jobs;
+        bool quit;
+
+        std::vector<EncoderScratch *> scratch;
+        boost::thread_group threads;
+};
+
+#endif /* ENCODERPOOL_H_ */
@@ -0,0 +1,158 @@
+/*
+ * FrameRing.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "FrameRing.h"
+
+#include <new>
+#include <cassert>
+#include <cstring>
+
+#include <boost/align/aligned_alloc.hpp>
+
+FrameRing::FrameRing(int capacity, int slotSize)
+ : numSlots(capacity),
+   dataSize(slotSize),
+   writeSequence(0)
+{
+    assert(capacity > 1 && slotSize > 0);
+
+    slots = static_cast<Slot *>(boost::alignment::aligned_alloc(CacheLineSize, sizeof(Slot) * numSlots));
+
+    int stride = (dataSize + CacheLineSize - 1) & ~(CacheLineSize - 1);
+
+    slotData = static_cast<uint8_t *>(boost::alignment::aligned_alloc(CacheLineSize, (size_t)stride * numSlots));
+
+    if(!slots || !slotData)
+    {
+        throw std::bad_alloc();
+    }
+
+    memset(slotData, 0, (size_t)stride * numSlots);
+
+    for(int i = 0; i < numSlots; i++)
+    {
+        Slot * slot = new (&slots[i]) Slot;
+        slot->sequence.store(0, boost::memory_order_relaxed);
+        slot->timestamp.store(0, boost::memory_order_relaxed);
+        slot->tag.store(0, boost::memory_order_relaxed);
+        slot->data = slotData + (size_t)stride * i;
+    }
+
+    head.sequence.store(0, boost::memory_order_release);
+}
+
+FrameRing::~FrameRing()
+{
+    for(int i = 0; i < numSlots; i++)
+    {
+        slots[i].~Slot();
+    }
+
+    boost::alignment::aligned_free(slots);
+    boost::alignment::aligned_free(slotData);
+}
+
+uint8_t * FrameRing::beginWrite()
+{
+    Slot & slot = slots[(writeSequence + 1) % numSlots];
+
+    /**
+     * Readers of whatever sequence this slot held before will see the write
+     * bit (or a newer sequence) on validation and discard what they read
+     */
+    slot.sequence.store((writeSequence + 1) | WriteBit, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_release);
+
+    return slot.data;
+}
+
+void FrameRing::publish(int64_t timestamp, int64_t tag)
+{
+    writeSequence++;
+
+    Slot & slot = slots[writeSequence % numSlots];
+
+    slot.timestamp.store(timestamp, boost::memory_order_relaxed);
+    slot.tag.store(tag, boost::memory_order_relaxed);
+    slot.sequence.store(writeSequence, boost::memory_order_release);
+
+    head.sequence.store(writeSequence, boost::memory_order_release);
+}
+
+uint64_t FrameRing::latest() const
+{
+    return head.sequence.load(boost::memory_order_acquire);
+}
+
+FrameRing::Status FrameRing::classify(uint64_t slotSequence, uint64_t sequence)
+{
+    uint64_t held = slotSequence & ~WriteBit;
+
+    if(held < sequence || (held == sequence && (slotSequence & WriteBit)))
+    {
+        return FrameNotReady;
+    }
+
+    if(held > sequence)
+    {
+        return FrameOverwritten;
+    }
+
+    return FrameOk;
+}
+
+FrameRing::Status FrameRing::read(uint64_t sequence, uint8_t * dst, int64_t & timestamp, int64_t & tag) const
+{
+    const uint8_t * data = 0;
+
+    Status status = peek(sequence, data, timestamp, tag);
+
+    if(status != FrameOk)
+    {
+        return status;
+    }
+
+    memcpy(dst, data, dataSize);
+
+    return validate(sequence);
+}
+
+FrameRing::Status FrameRing::peek(uint64_t sequence, const uint8_t *& data, int64_t & timestamp, int64_t & tag) const
+{
+    if(sequence == 0)
+    {
+        return FrameNotReady;
+    }
+
+    const Slot & slot = slotFor(sequence);
+
+    Status status = classify(slot.sequence.load(boost::memory_order_acquire), sequence);
+
+    if(status != FrameOk)
+    {
+        return status;
+    }
+
+    data = slot.data;
+    timestamp = slot.timestamp.load(boost::memory_order_relaxed);
+    tag = slot.tag.load(boost::memory_order_relaxed);
+
+    return FrameOk;
+}
+
+FrameRing::Status FrameRing::validate(uint64_t sequence) const
+{
+    boost::atomic_thread_fence(boost::memory_order_acquire);
+
+    Status status = classify(slotFor(sequence).sequence.load(boost::memory_order_relaxed), sequence);
+
+    /**
+     * The frame was complete when the reader started, anything other than
+     * an intact slot now means the producer has lapped it
+     */
+    return status == FrameOk ? FrameOk : FrameOverwritten;
+}
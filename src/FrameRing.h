@@ -0,0 +1,105 @@
+/*
+ * FrameRing.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef FRAMERING_H_
+#define FRAMERING_H_
+
+#include <stdint.h>
+
+#include <boost/config.hpp>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+
+/**
+ * Lock-free ring of fixed size frame slots with a single producer and any
+ * number of readers. Every published frame gets a sequence number starting
+ * at 1 and each slot records the sequence it currently holds, so a reader
+ * either sees the frame it asked for intact or is told it was overwritten.
+ */
+class FrameRing : public boost::noncopyable
+{
+    public:
+        enum Status
+        {
+            FrameOk,
+            FrameNotReady,
+            FrameOverwritten
+        };
+
+        static const int CacheLineSize = 64;
+
+        FrameRing(int capacity, int slotSize);
+        virtual ~FrameRing();
+
+        /**
+         * Producer only. Returns the buffer of the next slot, which stays
+         * invisible to readers until publish() is called
+         */
+        uint8_t * beginWrite();
+        void publish(int64_t timestamp, int64_t tag = 0);
+
+        /**
+         * Most recently published sequence, 0 if nothing has been published yet
+         */
+        uint64_t latest() const;
+
+        /**
+         * Copies the whole slot holding sequence into dst
+         */
+        Status read(uint64_t sequence, uint8_t * dst, int64_t & timestamp, int64_t & tag) const;
+
+        /**
+         * Zero copy access to the slot holding sequence. The producer may
+         * overwrite the data at any time, so anything derived from it is only
+         * trustworthy if validate() still returns FrameOk afterwards
+         */
+        Status peek(uint64_t sequence, const uint8_t *& data, int64_t & timestamp, int64_t & tag) const;
+        Status validate(uint64_t sequence) const;
+
+        int capacity() const
+        {
+            return numSlots;
+        }
+
+        int slotSize() const
+        {
+            return dataSize;
+        }
+
+    private:
+        static const uint64_t WriteBit = 1ULL << 63;
+
+        struct BOOST_ALIGNMENT(64) Slot
+        {
+            boost::atomic<uint64_t> sequence;
+            boost::atomic<int64_t> timestamp;
+            boost::atomic<int64_t> tag;
+            uint8_t * data;
+        };
+
+        struct BOOST_ALIGNMENT(64) Head
+        {
+            boost::atomic<uint64_t> sequence;
+        };
+
+        static Status classify(uint64_t slotSequence, uint64_t sequence);
+
+        const Slot & slotFor(uint64_t sequence) const
+        {
+            return slots[sequence % numSlots];
+        }
+
+        int numSlots;
+        int dataSize;
+        Slot * slots;
+        uint8_t * slotData;
+
+        Head head;
+        uint64_t writeSequence;
+};
+
+#endif /* FRAMERING_H_ */
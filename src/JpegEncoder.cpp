@@ -0,0 +1,550 @@
+/*
+ * JpegEncoder.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "JpegEncoder.h"
+
+#include <stdlib.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <jerror.h>
+
+JpegEncoder::JpegEncoder(int quality, Subsampling subsampling)
+ : quality(quality),
+   subsampling(subsampling)
+{
+    cinfo.err = jpeg_std_error(&errorManager.pub);
+    errorManager.pub.error_exit = &JpegEncoder::errorExit;
+
+    jpeg_create_compress(&cinfo);
+
+    /**
+     * Keeps libjpeg's manager for everything but the image pool
+     */
+    libjpegMemory = *cinfo.mem;
+
+    cinfo.client_data = this;
+    cinfo.mem->alloc_small = &JpegEncoder::allocSmall;
+    cinfo.mem->alloc_large = &JpegEncoder::allocLarge;
+    cinfo.mem->alloc_sarray = &JpegEncoder::allocSampleArray;
+    cinfo.mem->alloc_barray = &JpegEncoder::allocBlockArray;
+    cinfo.mem->free_pool = &JpegEncoder::freePool;
+
+    destination.pub.init_destination = &JpegEncoder::initDestination;
+    destination.pub.empty_output_buffer = &JpegEncoder::emptyOutputBuffer;
+    destination.pub.term_destination = &JpegEncoder::termDestination;
+    destination.out = 0;
+
+    cinfo.dest = &destination.pub;
+
+    /**
+     * The camera's chroma uses analogue YUV scaling (the constants in
+     * ImageYUV422::fillRGB), JPEG expects full range YCbCr
+     */
+    for(int i = 0; i < 256; i++)
+    {
+        int cb = 128 + (int)floor((i - 128) * (33292.0 / 16384.0) / 1.772 + 0.5);
+        int cr = 128 + (int)floor((i - 128) * (18678.0 / 16384.0) / 1.402 + 0.5);
+
+        cbFromU[i] = std::min(std::max(cb, 0), 255);
+        crFromV[i] = std::min(std::max(cr, 0), 255);
+    }
+}
+
+JpegEncoder::~JpegEncoder()
+{
+    jpeg_destroy_compress(&cinfo);
+}
+
+JpegEncoder::ImagePool::ImagePool()
+ : chunkSize(0),
+   used(0),
+   total(0)
+{
+}
+
+JpegEncoder::ImagePool::~ImagePool()
+{
+    for(size_t i = 0; i < chunks.size(); i++)
+    {
+        free(chunks[i]);
+    }
+}
+
+void JpegEncoder::ImagePool::addChunk(size_t size)
+{
+    void * chunk = malloc(size + Alignment);
+
+    if(chunk)
+    {
+        chunks.push_back(chunk);
+        chunkSize = size;
+        used = 0;
+    }
+}
+
+void * JpegEncoder::ImagePool::allocate(size_t size)
+{
+    size = (size + Alignment - 1) / Alignment * Alignment;
+
+    if(chunks.empty() || used + size > chunkSize)
+    {
+        addChunk(std::max(std::max(size, (size_t)MinChunkSize), total));
+
+        if(chunks.empty() || used + size > chunkSize)
+        {
+            return 0;
+        }
+    }
+
+    uint8_t * base = (uint8_t *)(((size_t)chunks.back() + Alignment - 1) / Alignment * Alignment);
+    void * memory = base + used;
+
+    used += size;
+    total += size;
+
+    return memory;
+}
+
+void JpegEncoder::ImagePool::reset()
+{
+    if(chunks.size() > 1)
+    {
+        for(size_t i = 0; i < chunks.size(); i++)
+        {
+            free(chunks[i]);
+        }
+
+        chunks.clear();
+
+        addChunk(total);
+    }
+
+    used = 0;
+    total = 0;
+}
+
+void * JpegEncoder::allocImage(j_common_ptr cinfo, size_t size)
+{
+    JpegEncoder * encoder = reinterpret_cast<JpegEncoder *>(cinfo->client_data);
+
+    void * memory = encoder->imagePool.allocate(size);
+
+    if(!memory)
+    {
+        ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 0);
+    }
+
+    return memory;
+}
+
+void * JpegEncoder::allocSmall(j_common_ptr cinfo, int poolId, size_t size)
+{
+    if(poolId != JPOOL_IMAGE)
+    {
+        return reinterpret_cast<JpegEncoder *>(cinfo->client_data)->libjpegMemory.alloc_small(cinfo, poolId, size);
+    }
+
+    return allocImage(cinfo, size);
+}
+
+void * JpegEncoder::allocLarge(j_common_ptr cinfo, int poolId, size_t size)
+{
+    if(poolId != JPOOL_IMAGE)
+    {
+        return reinterpret_cast<JpegEncoder *>(cinfo->client_data)->libjpegMemory.alloc_large(cinfo, poolId, size);
+    }
+
+    return allocImage(cinfo, size);
+}
+
+JSAMPARRAY JpegEncoder::allocSampleArray(j_common_ptr cinfo, int poolId, JDIMENSION samplesPerRow, JDIMENSION numRows)
+{
+    if(poolId != JPOOL_IMAGE)
+    {
+        return reinterpret_cast<JpegEncoder *>(cinfo->client_data)->libjpegMemory.alloc_sarray(cinfo, poolId, samplesPerRow, numRows);
+    }
+
+    /**
+     * Rows padded like libjpeg-turbo pads them, its SIMD code may run past
+     * the end of a row
+     */
+    size_t rowSize = (samplesPerRow * sizeof(JSAMPLE) + 63) / 64 * 64;
+
+    JSAMPARRAY rows = (JSAMPARRAY)allocImage(cinfo, numRows * sizeof(JSAMPROW));
+    JSAMPLE * samples = (JSAMPLE *)allocImage(cinfo, numRows * rowSize);
+
+    for(JDIMENSION i = 0; i < numRows; i++)
+    {
+        rows[i] = (JSAMPROW)((uint8_t *)samples + i * rowSize);
+    }
+
+    return rows;
+}
+
+JBLOCKARRAY JpegEncoder::allocBlockArray(j_common_ptr cinfo, int poolId, JDIMENSION blocksPerRow, JDIMENSION numRows)
+{
+    if(poolId != JPOOL_IMAGE)
+    {
+        return reinterpret_cast<JpegEncoder *>(cinfo->client_data)->libjpegMemory.alloc_barray(cinfo, poolId, blocksPerRow, numRows);
+    }
+
+    JBLOCKARRAY rows = (JBLOCKARRAY)allocImage(cinfo, numRows * sizeof(JBLOCKROW));
+    JBLOCKROW blocks = (JBLOCKROW)allocImage(cinfo, (size_t)numRows * blocksPerRow * sizeof(JBLOCK));
+
+    for(JDIMENSION i = 0; i < numRows; i++)
+    {
+        rows[i] = blocks + i * blocksPerRow;
+    }
+
+    return rows;
+}
+
+void JpegEncoder::freePool(j_common_ptr cinfo, int poolId)
+{
+    JpegEncoder * encoder = reinterpret_cast<JpegEncoder *>(cinfo->client_data);
+
+    if(poolId == JPOOL_IMAGE)
+    {
+        encoder->imagePool.reset();
+    }
+
+    /**
+     * Still owns the permanent pool and any virtual arrays
+     */
+    encoder->libjpegMemory.free_pool(cinfo, poolId);
+}
+
+void JpegEncoder::errorExit(j_common_ptr cinfo)
+{
+    ErrorManager * errorManager = reinterpret_cast<ErrorManager *>(cinfo->err);
+
+    longjmp(errorManager->jump, 1);
+}
+
+void JpegEncoder::initDestination(j_compress_ptr cinfo)
+{
+    Destination * destination = reinterpret_cast<Destination *>(cinfo->dest);
+
+    destination->pub.next_output_byte = &(*destination->out)[0];
+    destination->pub.free_in_buffer = destination->out->size();
+}
+
+boolean JpegEncoder::emptyOutputBuffer(j_compress_ptr cinfo)
+{
+    Destination * destination = reinterpret_cast<Destination *>(cinfo->dest);
+
+    /**
+     * Only happens if a frame encodes bigger than any before it
+     */
+    size_t used = destination->out->size();
+
+    destination->out->resize(used * 2);
+
+    destination->pub.next_output_byte = &(*destination->out)[used];
+    destination->pub.free_in_buffer = destination->out->size() - used;
+
+    return TRUE;
+}
+
+void JpegEncoder::termDestination(j_compress_ptr cinfo)
+{
+}
+
+void JpegEncoder::applySubsampling()
+{
+    switch(subsampling)
+    {
+        case Subsample444:
+            cinfo.comp_info[0].h_samp_factor = 1;
+            cinfo.comp_info[0].v_samp_factor = 1;
+            break;
+        case Subsample422:
+            cinfo.comp_info[0].h_samp_factor = 2;
+            cinfo.comp_info[0].v_samp_factor = 1;
+            break;
+        case Subsample420:
+            cinfo.comp_info[0].h_samp_factor = 2;
+            cinfo.comp_info[0].v_samp_factor = 2;
+            break;
+    }
+
+    for(int i = 1; i < cinfo.num_components; i++)
+    {
+        cinfo.comp_info[i].h_samp_factor = 1;
+        cinfo.comp_info[i].v_samp_factor = 1;
+    }
+}
+
+void JpegEncoder::prepareOutput(std::vector<uint8_t> & out)
+{
+    if(out.size() < 4096)
+    {
+        out.resize(4096);
+    }
+
+    destination.out = &out;
+}
+
+int JpegEncoder::encode(const uint8_t * pixels, int width, int height, int channels, int rowStride, std::vector<uint8_t> & out)
+{
+    if(channels != 3)
+    {
+        return -1;
+    }
+
+    prepareOutput(out);
+
+    if(rows.size() < (size_t)height)
+    {
+        rows.resize(height);
+    }
+
+    if(setjmp(errorManager.jump))
+    {
+        jpeg_abort_compress(&cinfo);
+        return -1;
+    }
+
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+
+#ifdef JCS_EXTENSIONS
+    cinfo.in_color_space = JCS_EXT_BGR;
+
+    for(int i = 0; i < height; i++)
+    {
+        rows[i] = const_cast<JSAMPROW>(pixels + i * rowStride);
+    }
+#else
+    cinfo.in_color_space = JCS_RGB;
+
+    if(swapped.size() < (size_t)width * height * 3)
+    {
+        swapped.resize(width * height * 3);
+    }
+
+    for(int i = 0; i < height; i++)
+    {
+        const uint8_t * src = pixels + i * rowStride;
+        uint8_t * dst = &swapped[i * width * 3];
+
+        for(int j = 0; j < width * 3; j += 3)
+        {
+            dst[j] = src[j + 2];
+            dst[j + 1] = src[j + 1];
+            dst[j + 2] = src[j];
+        }
+
+        rows[i] = dst;
+    }
+#endif
+
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    applySubsampling();
+
+    jpeg_start_compress(&cinfo, TRUE);
+
+    while(cinfo.next_scanline < cinfo.image_height)
+    {
+        jpeg_write_scanlines(&cinfo, &rows[cinfo.next_scanline], cinfo.image_height - cinfo.next_scanline);
+    }
+
+    jpeg_finish_compress(&cinfo);
+
+    return out.size() - destination.pub.free_in_buffer;
+}
+
+int JpegEncoder::encodeRows(const RowSource & source, int width, int height, int bandRows, std::vector<uint8_t> & out)
+{
+    if(bandRows < 1)
+    {
+        return -1;
+    }
+
+    prepareOutput(out);
+
+    int bandStride = width * 3;
+
+    if(band.size() < (size_t)bandStride * bandRows)
+    {
+        band.resize(bandStride * bandRows);
+    }
+
+    if(rows.size() < (size_t)bandRows)
+    {
+        rows.resize(bandRows);
+    }
+
+    for(int i = 0; i < bandRows; i++)
+    {
+        rows[i] = &band[i * bandStride];
+    }
+
+    if(setjmp(errorManager.jump))
+    {
+        jpeg_abort_compress(&cinfo);
+        return -1;
+    }
+
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+
+#ifdef JCS_EXTENSIONS
+    cinfo.in_color_space = JCS_EXT_BGR;
+#else
+    cinfo.in_color_space = JCS_RGB;
+#endif
+
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    applySubsampling();
+
+    jpeg_start_compress(&cinfo, TRUE);
+
+    while(cinfo.next_scanline < cinfo.image_height)
+    {
+        int firstRow = cinfo.next_scanline;
+        int numRows = std::min(bandRows, height - firstRow);
+
+        source(firstRow, firstRow + numRows, &band[0], bandStride);
+
+#ifndef JCS_EXTENSIONS
+        for(int i = 0; i < numRows; i++)
+        {
+            uint8_t * row = rows[i];
+
+            for(int j = 0; j < width * 3; j += 3)
+            {
+                std::swap(row[j], row[j + 2]);
+            }
+        }
+#endif
+
+        /**
+         * libjpeg buffers whatever doesn't fill a whole MCU row itself, so
+         * every band is taken in one call
+         */
+        jpeg_write_scanlines(&cinfo, &rows[0], numRows);
+    }
+
+    jpeg_finish_compress(&cinfo);
+
+    return out.size() - destination.pub.free_in_buffer;
+}
+
+int JpegEncoder::encodeUyvy(const uint8_t * uyvy, int width, int height, int rowStride, std::vector<uint8_t> & out)
+{
+    if(width % 2)
+    {
+        return -1;
+    }
+
+    prepareOutput(out);
+
+    if(setjmp(errorManager.jump))
+    {
+        jpeg_abort_compress(&cinfo);
+        return -1;
+    }
+
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_YCbCr;
+
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    applySubsampling();
+
+    cinfo.raw_data_in = TRUE;
+
+    int lumaHorizontal = cinfo.comp_info[0].h_samp_factor;
+    int lumaVertical = cinfo.comp_info[0].v_samp_factor;
+
+    /**
+     * libjpeg takes one MCU row per call, with every plane padded out to
+     * whole blocks. Padding repeats the last row and column
+     */
+    int lumaRows = lumaVertical * DCTSIZE;
+    int lumaWidth = (width + lumaHorizontal * DCTSIZE - 1) / (lumaHorizontal * DCTSIZE) * (lumaHorizontal * DCTSIZE);
+    int chromaWidth = lumaWidth / lumaHorizontal;
+
+    planes.resize(lumaWidth * lumaRows + chromaWidth * DCTSIZE * 2);
+
+    planeRows[0].resize(lumaRows);
+    planeRows[1].resize(DCTSIZE);
+    planeRows[2].resize(DCTSIZE);
+
+    for(int i = 0; i < lumaRows; i++)
+    {
+        planeRows[0][i] = &planes[i * lumaWidth];
+    }
+
+    for(int i = 0; i < DCTSIZE; i++)
+    {
+        planeRows[1][i] = &planes[lumaWidth * lumaRows + i * chromaWidth];
+        planeRows[2][i] = &planes[lumaWidth * lumaRows + (DCTSIZE + i) * chromaWidth];
+    }
+
+    JSAMPARRAY planeArrays[3] = {&planeRows[0][0], &planeRows[1][0], &planeRows[2][0]};
+
+    int lastPair = width / 2 - 1;
+
+    jpeg_start_compress(&cinfo, TRUE);
+
+    while(cinfo.next_scanline < cinfo.image_height)
+    {
+        int top = cinfo.next_scanline;
+
+        for(int i = 0; i < lumaRows; i++)
+        {
+            const uint8_t * src = uyvy + std::min(top + i, height - 1) * rowStride;
+            uint8_t * y = planeRows[0][i];
+
+            for(int j = 0; j < width; j++)
+            {
+                y[j] = src[j * 2 + 1];
+            }
+
+            for(int j = width; j < lumaWidth; j++)
+            {
+                y[j] = y[width - 1];
+            }
+        }
+
+        for(int i = 0; i < DCTSIZE; i++)
+        {
+            const uint8_t * src = uyvy + std::min(top + i * lumaVertical, height - 1) * rowStride;
+            const uint8_t * below = uyvy + std::min(top + i * lumaVertical + lumaVertical - 1, height - 1) * rowStride;
+            uint8_t * cb = planeRows[1][i];
+            uint8_t * cr = planeRows[2][i];
+
+            for(int j = 0; j < chromaWidth; j++)
+            {
+                /**
+                 * Each UYVY pair shares one chroma sample, at 4:4:4 it is
+                 * repeated for both pixels
+                 */
+                int pair = std::min(lumaHorizontal == 2 ? j : j / 2, lastPair) * 4;
+
+                cb[j] = cbFromU[(src[pair] + below[pair] + 1) >> 1];
+                cr[j] = crFromV[(src[pair + 2] + below[pair + 2] + 1) >> 1];
+            }
+        }
+
+        jpeg_write_raw_data(&cinfo, planeArrays, lumaRows);
+    }
+
+    jpeg_finish_compress(&cinfo);
+
+    return out.size() - destination.pub.free_in_buffer;
+}
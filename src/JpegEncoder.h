@@ -0,0 +1,177 @@
+/*
+ * JpegEncoder.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef JPEGENCODER_H_
+#define JPEGENCODER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include "CodecRegistry.h"
+
+/**
+ * libjpeg compressor that is created once per worker and writes straight
+ * into a caller owned output buffer. The buffer only ever grows, and
+ * libjpeg's per image allocations come from a pool kept by the encoder,
+ * so once both are big enough encoding does no heap allocation at all
+ */
+class JpegEncoder : public ImageEncoder
+{
+    public:
+        enum Subsampling
+        {
+            Subsample444,
+            Subsample422,
+            Subsample420
+        };
+
+        JpegEncoder(int quality = 90, Subsampling subsampling = Subsample420);
+        virtual ~JpegEncoder();
+
+        /**
+         * Encodes a packed 8 bit 3 channel image into out and returns the
+         * encoded length, or -1 on failure. Channels are taken in the same
+         * order cvEncodeImage used (as BGR) so existing readers decoding with
+         * OpenCV get the original bytes back
+         */
+        int encode(const uint8_t * pixels, int width, int height, int channels, int rowStride, std::vector<uint8_t> & out);
+
+        /**
+         * Encodes a packed UYVY 4:2:2 image (as delivered by PrimeSense
+         * devices) handing the planes to libjpeg as raw YCbCr, so no RGB
+         * conversion happens either side. Chroma is resampled to the
+         * configured subsampling and rescaled from the camera's YUV to JPEG's
+         * YCbCr. Unlike encode() the result decodes to true channel order
+         */
+        int encodeUyvy(const uint8_t * uyvy, int width, int height, int rowStride, std::vector<uint8_t> & out);
+
+        /**
+         * Fills rows firstRow to lastRow of the image into rows, rowStride
+         * bytes apart, as packed 8 bit 3 channel pixels
+         */
+        typedef boost::function<void (int firstRow, int lastRow, uint8_t * rows, int rowStride)> RowSource;
+
+        /**
+         * Same output as encode(), but pulls the image from source bandRows
+         * rows at a time into a small band buffer and compresses each band
+         * straight away, so the whole image never exists at once
+         */
+        int encodeRows(const RowSource & source, int width, int height, int bandRows, std::vector<uint8_t> & out);
+
+        void setQuality(int quality)
+        {
+            this->quality = quality;
+        }
+
+        void setLevel(int level)
+        {
+            setQuality(level);
+        }
+
+        int getQuality() const
+        {
+            return quality;
+        }
+
+        void setSubsampling(Subsampling subsampling)
+        {
+            this->subsampling = subsampling;
+        }
+
+        Subsampling getSubsampling() const
+        {
+            return subsampling;
+        }
+
+    private:
+        struct ErrorManager
+        {
+            jpeg_error_mgr pub;
+            jmp_buf jump;
+        };
+
+        struct Destination
+        {
+            jpeg_destination_mgr pub;
+            std::vector<uint8_t> * out;
+        };
+
+        /**
+         * Backs libjpeg's JPOOL_IMAGE allocations, which its own memory
+         * manager mallocs at jpeg_start_compress and frees again when the
+         * image is done. Here they are carved out of chunks that are only
+         * reset after each image. Whenever an image needed more than one
+         * chunk they are merged into one big enough for it, so the next
+         * image of that size allocates nothing. Permanent allocations and
+         * virtual arrays stay with libjpeg's manager
+         */
+        class ImagePool
+        {
+            public:
+                ImagePool();
+                ~ImagePool();
+
+                void * allocate(size_t size);
+                void reset();
+
+            private:
+                /**
+                 * libjpeg-turbo's SIMD code wants 32 byte aligned buffers
+                 */
+                static const size_t Alignment = 32;
+                static const size_t MinChunkSize = 64 * 1024;
+
+                void addChunk(size_t size);
+
+                std::vector<void *> chunks;
+                size_t chunkSize;
+                size_t used;
+                size_t total;
+        };
+
+        static void * allocSmall(j_common_ptr cinfo, int poolId, size_t size);
+        static void * allocLarge(j_common_ptr cinfo, int poolId, size_t size);
+        static JSAMPARRAY allocSampleArray(j_common_ptr cinfo, int poolId, JDIMENSION samplesPerRow, JDIMENSION numRows);
+        static JBLOCKARRAY allocBlockArray(j_common_ptr cinfo, int poolId, JDIMENSION blocksPerRow, JDIMENSION numRows);
+        static void freePool(j_common_ptr cinfo, int poolId);
+        static void * allocImage(j_common_ptr cinfo, size_t size);
+
+        static void errorExit(j_common_ptr cinfo);
+        static void initDestination(j_compress_ptr cinfo);
+        static boolean emptyOutputBuffer(j_compress_ptr cinfo);
+        static void termDestination(j_compress_ptr cinfo);
+
+        void applySubsampling();
+        void prepareOutput(std::vector<uint8_t> & out);
+
+        jpeg_compress_struct cinfo;
+        ErrorManager errorManager;
+        Destination destination;
+
+        ImagePool imagePool;
+        jpeg_memory_mgr libjpegMemory;
+
+        std::vector<JSAMPROW> rows;
+        std::vector<uint8_t> swapped;
+        std::vector<uint8_t> band;
+
+        std::vector<uint8_t> planes;
+        std::vector<JSAMPROW> planeRows[3];
+        uint8_t cbFromU[256];
+        uint8_t crFromV[256];
+
+        int quality;
+        Subsampling subsampling;
+};
+
+#endif /* JPEGENCODER_H_ */
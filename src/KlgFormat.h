@@ -0,0 +1,217 @@
+/*
+ * KlgFormat.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef KLGFORMAT_H_
+#define KLGFORMAT_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <vector>
+
+#include "CodecRegistry.h"
+
+/**
+ * Version 1 files start with a bare int32_t frame count. Version 2 files
+ * start with a KlgHeader instead, whose magic reads as a negative frame
+ * count so old readers reject them rather than misparse them. Frame
+ * records are the same in both (see Logger::writeData). headerSize is
+ * the offset of the first frame record, so fields can be appended later.
+ * Readers zero whatever a shorter header doesn't have (see KlgReader).
+ *
+ * Version 3 follows every frame record with the CRC-32 of the record, so
+ * the last intact frame of a recording that was cut short can be found.
+ * numFrames is rewritten every so often while recording, in every
+ * version, and only ever counts records that have been written in full
+ */
+static const uint32_t klgMagic = 0xff474c4b; // "KLG\xff"
+static const uint16_t klgVersion = 3;
+static const uint16_t klgFirstCrcVersion = 3;
+
+/**
+ * KlgPixelBayerGrbg8 is the Kinect's raw 8 bit GRBG mosaic (rows alternate
+ * G R G R ... and B G B G ...), encoded as width / 2 pixels of 2 channels
+ * each and left for the reader to debayer.
+ *
+ * KlgPixelYuv422 is the PrimeSense UYVY output. JPEG is encoded straight
+ * from it and decodes in true channel order, unlike KlgPixelRgb888 JPEGs
+ * which decode with red and blue swapped like cvEncodeImage's did. Other
+ * codecs store the UYVY bytes as width pixels of 2 channels
+ */
+enum KlgPixelFormat
+{
+    KlgPixelDepth16 = 0,
+    KlgPixelRgb888 = 1,
+    KlgPixelBayerGrbg8 = 2,
+    KlgPixelYuv422 = 3
+};
+
+struct KlgStreamDescriptor
+{
+    uint16_t width;
+    uint16_t height;
+    uint8_t pixelFormat;
+    uint8_t codec;
+    int8_t level;
+    uint8_t reserved;
+};
+
+static const int klgIdentityLength = 32;
+
+/**
+ * Focal lengths are in pixels at the stream's resolution and the baseline
+ * between projector and IR camera is in metres, 0 if unknown. Depth is
+ * registered to the RGB camera, so both focal lengths are normally the
+ * same. Identity strings are NUL terminated and truncated to fit
+ */
+struct KlgHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    int32_t numFrames;
+    KlgStreamDescriptor depth;
+    KlgStreamDescriptor image;
+    float depthFocalLength;
+    float imageFocalLength;
+    float baseline;
+    uint16_t vendorId;
+    uint16_t productId;
+    char vendorName[klgIdentityLength];
+    char productName[klgIdentityLength];
+    char serialNumber[klgIdentityLength];
+};
+
+inline void initKlgStreamDescriptor(KlgStreamDescriptor & descriptor, int width, int height, KlgPixelFormat pixelFormat, CodecId codec, int level)
+{
+    descriptor.width = width;
+    descriptor.height = height;
+    descriptor.pixelFormat = pixelFormat;
+    descriptor.codec = codec;
+    descriptor.level = level;
+    descriptor.reserved = 0;
+}
+
+inline void initKlgHeader(KlgHeader & header)
+{
+    memset(&header, 0, sizeof(KlgHeader));
+
+    header.magic = klgMagic;
+    header.version = klgVersion;
+    header.headerSize = sizeof(KlgHeader);
+    header.numFrames = 0;
+}
+
+inline void setKlgIdentity(char (&field)[klgIdentityLength], const char * value)
+{
+    strncpy(field, value ? value : "", klgIdentityLength - 1);
+    field[klgIdentityLength - 1] = 0;
+}
+
+/**
+ * Files whose recording stopped cleanly (or that went through KlgIndex) end
+ * with one KlgIndexEntry per frame record followed by a KlgIndexTrailer, so
+ * readers can seek straight to any frame. Readers going by numFrames never
+ * get as far as the index. Sizes are those in the record
+ */
+static const uint32_t klgIndexMagic = 0x5844494b; // "KIDX"
+
+struct KlgIndexEntry
+{
+    int64_t timestamp;
+    int64_t offset;
+    int32_t depthSize;
+    int32_t imageSize;
+};
+
+/**
+ * Last bytes of an indexed file, indexOffset is where the first entry and
+ * therefore also where the frame records end
+ */
+struct KlgIndexTrailer
+{
+    int64_t indexOffset;
+    int32_t numEntries;
+    uint32_t magic;
+};
+
+inline bool klgHasRecordCrc(int version)
+{
+    return version >= klgFirstCrcVersion;
+}
+
+/**
+ * Size of the record an index entry points at, including its CRC
+ */
+inline int64_t klgRecordSize(const KlgIndexEntry & entry, int version)
+{
+    return sizeof(int64_t) + 2 * sizeof(int32_t) + (int64_t)entry.depthSize + entry.imageSize + (klgHasRecordCrc(version) ? sizeof(uint32_t) : 0);
+}
+
+inline void initKlgIndexTrailer(KlgIndexTrailer & trailer, int64_t indexOffset, int32_t numEntries)
+{
+    trailer.indexOffset = indexOffset;
+    trailer.numEntries = numEntries;
+    trailer.magic = klgIndexMagic;
+}
+
+/**
+ * Appends the index and trailer at the current position, which has to be
+ * indexOffset
+ */
+inline bool writeKlgIndex(FILE * file, int64_t indexOffset, const std::vector<KlgIndexEntry> & index)
+{
+    KlgIndexTrailer trailer;
+
+    initKlgIndexTrailer(trailer, indexOffset, index.size());
+
+    return (index.empty() || fwrite(&index[0], sizeof(KlgIndexEntry), index.size(), file) == index.size()) &&
+           fwrite(&trailer, sizeof(KlgIndexTrailer), 1, file) == 1;
+}
+
+/**
+ * 64 bit file offsets and truncation for logs read and fixed up through
+ * stdio, which POSIX and Windows spell differently
+ */
+inline int klgSeek(FILE * file, int64_t offset, int whence)
+{
+#ifdef _WIN32
+    return _fseeki64(file, offset, whence);
+#else
+    return fseeko(file, offset, whence);
+#endif
+}
+
+inline int64_t klgTell(FILE * file)
+{
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return ftello(file);
+#endif
+}
+
+/**
+ * Anything still buffered in file has to be flushed first
+ */
+inline bool klgTruncate(FILE * file, int64_t size)
+{
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), size) == 0;
+#else
+    return ftruncate(fileno(file), size) == 0;
+#endif
+}
+
+#endif /* KLGFORMAT_H_ */
@@ -0,0 +1,205 @@
+/*
+ * KlgIndex.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include <iostream>
+
+#include <boost/format.hpp>
+
+#include "KlgReader.h"
+
+/**
+ * Appends the frame index footer to logs written before the writer had
+ * one, or whose recording never stopped cleanly. Any partial record at
+ * the end is cut off and the frame count in the header is corrected.
+ * From version 3 on every record's CRC is checked and the file is cut at
+ * the first one that doesn't match.
+ *
+ * Version 1 files have no magic, so any file would open as one. They are
+ * only rewritten when asked to with --legacy, and not at all if not a
+ * single plausible record is found.
+ *
+ * With --verify the file is only read, every frame's depth and image are
+ * decoded and any that doesn't decode, or data after the last good record,
+ * is reported
+ */
+static int verify(KlgReader & reader, const std::string & filename)
+{
+    KlgFrame frame;
+    std::vector<uint16_t> depth;
+    std::vector<uint8_t> rgb;
+    int numFrames = 0;
+    int badFrames = 0;
+    int badImages = 0;
+
+    while(reader.readFrame(frame))
+    {
+        if(!reader.decodeDepth(frame, depth))
+        {
+            if(!badFrames)
+            {
+                std::cout << boost::format("Frame %d at offset %d: depth doesn't decode") % numFrames % frame.offset << std::endl;
+            }
+
+            badFrames++;
+        }
+
+        if(!reader.decodeImage(frame, rgb))
+        {
+            if(!badImages)
+            {
+                std::cout << boost::format("Frame %d at offset %d: image doesn't decode") % numFrames % frame.offset << std::endl;
+            }
+
+            badImages++;
+        }
+
+        numFrames++;
+    }
+
+    int64_t trailing = reader.framesEndOffset() - reader.tell();
+
+    std::cout << boost::format("%s: %d frames, %d with bad depth, %d with bad images") % filename % numFrames % badFrames % badImages;
+
+    if(trailing > 0)
+    {
+        std::cout << boost::format(", then %d bytes that aren't a valid record") % trailing;
+    }
+
+    std::cout << std::endl;
+
+    return badFrames || badImages || trailing ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool legacy = false;
+    bool verifyOnly = false;
+    std::string filename;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if(arg == "--legacy")
+        {
+            legacy = true;
+        }
+        else if(arg == "--verify")
+        {
+            verifyOnly = true;
+        }
+        else if(filename.empty() && arg.substr(0, 2) != "--")
+        {
+            filename = arg;
+        }
+        else
+        {
+            filename.clear();
+            break;
+        }
+    }
+
+    if(filename.empty())
+    {
+        std::cout << "Usage: KlgIndex [--legacy | --verify] <log.klg>" << std::endl;
+        return 1;
+    }
+
+    KlgReader reader;
+
+    if(!reader.open(filename))
+    {
+        std::cout << boost::format("Could not read %s as a log") % filename << std::endl;
+        return 1;
+    }
+
+    if(verifyOnly)
+    {
+        return verify(reader, filename);
+    }
+
+    if(reader.getVersion() == 1 && !legacy)
+    {
+        std::cout << boost::format("%s has no KlgHeader, if it is a version 1 log run again with --legacy") % filename << std::endl;
+        return 1;
+    }
+
+    if(reader.hasIndex())
+    {
+        std::cout << boost::format("%s is already indexed, %d frames") % filename % reader.getIndex().size() << std::endl;
+        return 0;
+    }
+
+    std::vector<KlgIndexEntry> index;
+    KlgIndexEntry entry;
+
+    if(klgHasRecordCrc(reader.getVersion()))
+    {
+        KlgFrame frame;
+
+        while(reader.readFrame(frame, entry))
+        {
+            index.push_back(entry);
+        }
+    }
+    else
+    {
+        while(reader.skipFrame(entry))
+        {
+            index.push_back(entry);
+        }
+    }
+
+    if(index.empty() && reader.getVersion() == 1)
+    {
+        std::cout << boost::format("%s doesn't hold a single valid frame, leaving it alone") % filename << std::endl;
+        return 1;
+    }
+
+    int64_t indexOffset = reader.tell();
+    int64_t trailing = reader.framesEndOffset() - indexOffset;
+    long numFramesOffset = reader.getVersion() == 1 ? 0 : offsetof(KlgHeader, numFrames);
+
+    reader.close();
+
+    FILE * file = fopen(filename.c_str(), "rb+");
+
+    int32_t numFrames = index.size();
+
+    bool ok = file &&
+              klgSeek(file, indexOffset, SEEK_SET) == 0 &&
+              writeKlgIndex(file, indexOffset, index) &&
+              klgSeek(file, numFramesOffset, SEEK_SET) == 0 &&
+              fwrite(&numFrames, sizeof(int32_t), 1, file) == 1 &&
+              fflush(file) == 0 &&
+              klgTruncate(file, indexOffset + index.size() * sizeof(KlgIndexEntry) + sizeof(KlgIndexTrailer));
+
+    if(file)
+    {
+        fclose(file);
+    }
+
+    if(!ok)
+    {
+        std::cout << boost::format("Failed to write the index to %s") % filename << std::endl;
+        return 1;
+    }
+
+    std::cout << boost::format("Indexed %d frames in %s") % numFrames % filename;
+
+    if(trailing > 0)
+    {
+        std::cout << boost::format(", dropped a %d byte partial or corrupt record") % trailing;
+    }
+
+    std::cout << std::endl;
+
+    return 0;
+}
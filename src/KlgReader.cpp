@@ -0,0 +1,483 @@
+/*
+ * KlgReader.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "KlgReader.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "DepthFormat.h"
+
+/**
+ * Each missing colour is the average of the pixels of that colour among the
+ * 8 neighbours, rows alternating G R G R ... and B G B G ...
+ */
+static void debayerGrbg(const uint8_t * bayer, int width, int height, uint8_t * rgb)
+{
+    for(int y = 0; y < height; y++)
+    {
+        for(int x = 0; x < width; x++)
+        {
+            int sums[3] = {0, 0, 0};
+            int counts[3] = {0, 0, 0};
+
+            for(int dy = -1; dy <= 1; dy++)
+            {
+                for(int dx = -1; dx <= 1; dx++)
+                {
+                    int ny = y + dy;
+                    int nx = x + dx;
+
+                    if(ny < 0 || ny >= height || nx < 0 || nx >= width)
+                    {
+                        continue;
+                    }
+
+                    int colour = (ny & 1) == (nx & 1) ? 1 : (ny & 1) ? 2 : 0;
+
+                    sums[colour] += bayer[ny * width + nx];
+                    counts[colour]++;
+                }
+            }
+
+            int own = (y & 1) == (x & 1) ? 1 : (y & 1) ? 2 : 0;
+            uint8_t * pixel = rgb + (y * width + x) * 3;
+
+            for(int c = 0; c < 3; c++)
+            {
+                pixel[c] = c == own ? bayer[y * width + x] : (sums[c] + counts[c] / 2) / std::max(counts[c], 1);
+            }
+        }
+    }
+}
+
+static uint8_t clipChar(int value)
+{
+    return value > 255 ? 255 : value < 0 ? 0 : value;
+}
+
+/**
+ * Same fixed point conversion as ImageYUV422::fillRGB
+ */
+static void uyvyToRgb(const uint8_t * uyvy, int numPixels, uint8_t * rgb)
+{
+    for(int i = 0; i < numPixels; i += 2, uyvy += 4, rgb += 6)
+    {
+        int u = uyvy[0] - 128;
+        int v = uyvy[2] - 128;
+
+        for(int j = 0; j < 2; j++)
+        {
+            int luma = uyvy[1 + j * 2];
+
+            rgb[j * 3] = clipChar(luma + ((v * 18678 + 8192) >> 14));
+            rgb[j * 3 + 1] = clipChar(luma + ((v * -9519 - u * 6472 + 8192) >> 14));
+            rgb[j * 3 + 2] = clipChar(luma + ((u * 33292 + 8192) >> 14));
+        }
+    }
+}
+
+KlgReader::KlgReader()
+ : file(0),
+   firstFrame(0),
+   fileSize(0),
+   dataEnd(-1),
+   previousDepthEnd(-1)
+{
+    initKlgHeader(header);
+}
+
+KlgReader::~KlgReader()
+{
+    close();
+}
+
+bool KlgReader::open(const std::string & filename)
+{
+    close();
+
+    file = fopen(filename.c_str(), "rb");
+
+    if(!file)
+    {
+        return false;
+    }
+
+    initKlgHeader(header);
+
+    int32_t numFrames;
+
+    if(klgSeek(file, 0, SEEK_END) != 0 ||
+       (fileSize = klgTell(file)) < (int64_t)sizeof(int32_t) ||
+       klgSeek(file, 0, SEEK_SET) != 0 ||
+       fread(&numFrames, sizeof(int32_t), 1, file) != 1)
+    {
+        close();
+        return false;
+    }
+
+    if((uint32_t)numFrames != klgMagic)
+    {
+        /**
+         * Version 1, the count is all there is
+         */
+        header.version = 1;
+        header.headerSize = sizeof(int32_t);
+        header.numFrames = numFrames;
+
+        initKlgStreamDescriptor(header.depth, 640, 480, KlgPixelDepth16, CodecZlib, -1);
+        initKlgStreamDescriptor(header.image, 640, 480, KlgPixelRgb888, CodecJpeg, -1);
+
+        firstFrame = sizeof(int32_t);
+    }
+    else
+    {
+        uint16_t version, headerSize;
+
+        if(fread(&version, sizeof(uint16_t), 1, file) != 1 ||
+           fread(&headerSize, sizeof(uint16_t), 1, file) != 1 ||
+           version < 2 ||
+           version > klgVersion ||
+           headerSize < offsetof(KlgHeader, depthFocalLength))
+        {
+            close();
+            return false;
+        }
+
+        /**
+         * Older writers' headers stop short and newer ones may have appended
+         * fields, either way only the part both know about is taken
+         */
+        size_t known = std::min((size_t)headerSize, sizeof(KlgHeader));
+
+        if(klgSeek(file, 0, SEEK_SET) != 0 || fread(&header, known, 1, file) != 1)
+        {
+            close();
+            return false;
+        }
+
+        header.vendorName[klgIdentityLength - 1] = 0;
+        header.productName[klgIdentityLength - 1] = 0;
+        header.serialNumber[klgIdentityLength - 1] = 0;
+
+        firstFrame = headerSize;
+    }
+
+    loadIndex();
+
+    return seek(firstFrame);
+}
+
+bool KlgReader::loadIndex()
+{
+    index.clear();
+    dataEnd = -1;
+
+    KlgIndexTrailer trailer;
+
+    if(fileSize < firstFrame + (int64_t)sizeof(KlgIndexTrailer) ||
+       klgSeek(file, fileSize - sizeof(KlgIndexTrailer), SEEK_SET) != 0 ||
+       fread(&trailer, sizeof(KlgIndexTrailer), 1, file) != 1)
+    {
+        return false;
+    }
+
+    /**
+     * Anything else at the end is frame data that happens to look like a
+     * trailer, or an index cut short
+     */
+    if(trailer.magic != klgIndexMagic ||
+       trailer.numEntries < 0 ||
+       trailer.indexOffset < firstFrame ||
+       trailer.indexOffset + trailer.numEntries * (int64_t)sizeof(KlgIndexEntry) + (int64_t)sizeof(KlgIndexTrailer) != fileSize)
+    {
+        return false;
+    }
+
+    index.resize(trailer.numEntries);
+
+    if(klgSeek(file, trailer.indexOffset, SEEK_SET) != 0 ||
+       (!index.empty() && fread(&index[0], sizeof(KlgIndexEntry), index.size(), file) != index.size()))
+    {
+        index.clear();
+        return false;
+    }
+
+    dataEnd = trailer.indexOffset;
+
+    return true;
+}
+
+void KlgReader::close()
+{
+    if(file)
+    {
+        fclose(file);
+        file = 0;
+    }
+
+    index.clear();
+    dataEnd = -1;
+    fileSize = 0;
+    previousDepth.clear();
+    previousDepthEnd = -1;
+}
+
+bool KlgReader::readRecordHeader(KlgIndexEntry & entry)
+{
+    entry.offset = tell();
+
+    /**
+     * A record has to fit entirely before the index or the end of the file.
+     * Version 1 has no magic to tell a log from any other file, but its
+     * writer always gave a timestamp and both a zlib and a JPEG stream
+     */
+    return entry.offset >= firstFrame &&
+           fread(&entry.timestamp, sizeof(int64_t), 1, file) == 1 &&
+           fread(&entry.depthSize, sizeof(int32_t), 1, file) == 1 &&
+           fread(&entry.imageSize, sizeof(int32_t), 1, file) == 1 &&
+           entry.depthSize >= 0 &&
+           entry.imageSize >= 0 &&
+           (header.version > 1 || (entry.timestamp > 0 && entry.depthSize > 0 && entry.imageSize > 0)) &&
+           entry.offset + klgRecordSize(entry, header.version) <= framesEndOffset();
+}
+
+bool KlgReader::readFrame(KlgFrame & frame)
+{
+    KlgIndexEntry entry;
+
+    return readFrame(frame, entry);
+}
+
+bool KlgReader::readFrame(KlgFrame & frame, KlgIndexEntry & entry)
+{
+    if(!file)
+    {
+        return false;
+    }
+
+    bool ok = readRecordHeader(entry);
+
+    if(ok)
+    {
+        frame.offset = entry.offset;
+        frame.timestamp = entry.timestamp;
+        frame.depth.resize(entry.depthSize);
+        frame.image.resize(entry.imageSize);
+
+        ok = (entry.depthSize == 0 || fread(&frame.depth[0], entry.depthSize, 1, file) == 1) &&
+             (entry.imageSize == 0 || fread(&frame.image[0], entry.imageSize, 1, file) == 1);
+    }
+
+    if(ok && klgHasRecordCrc(header.version))
+    {
+        boost::crc_32_type crc;
+        uint32_t checksum;
+
+        crc.process_bytes(&entry.timestamp, sizeof(int64_t));
+        crc.process_bytes(&entry.depthSize, sizeof(int32_t));
+        crc.process_bytes(&entry.imageSize, sizeof(int32_t));
+        crc.process_bytes(frame.depth.empty() ? 0 : &frame.depth[0], frame.depth.size());
+        crc.process_bytes(frame.image.empty() ? 0 : &frame.image[0], frame.image.size());
+
+        ok = fread(&checksum, sizeof(uint32_t), 1, file) == 1 && checksum == crc.checksum();
+    }
+
+    if(!ok)
+    {
+        seek(entry.offset);
+    }
+
+    return ok;
+}
+
+bool KlgReader::skipFrame(KlgIndexEntry & entry)
+{
+    if(!file)
+    {
+        return false;
+    }
+
+    if(!readRecordHeader(entry) || !seek(entry.offset + klgRecordSize(entry, header.version)))
+    {
+        seek(entry.offset);
+        return false;
+    }
+
+    return true;
+}
+
+bool KlgReader::readFrame(int frameNumber, KlgFrame & frame)
+{
+    if(frameNumber < 0 || frameNumber >= (int)index.size())
+    {
+        return false;
+    }
+
+    return seek(index[frameNumber].offset) && readFrame(frame);
+}
+
+bool KlgReader::decodeDepth(const KlgFrame & frame, std::vector<uint16_t> & depth)
+{
+    int width = header.depth.width;
+    int height = header.depth.height;
+    int numPixels = width * height;
+    int size = frame.depth.size();
+    const uint8_t * payload = size ? &frame.depth[0] : 0;
+
+    depth.resize(numPixels);
+
+    bool ok;
+
+    if(!isDepthPayloadHeader(payload, size))
+    {
+        /**
+         * Bare zlib, as in the original format
+         */
+        ok = CodecRegistry::decodeDepth(CodecZlib, payload, size, &depth[0], numPixels);
+    }
+    else
+    {
+        DepthPayloadHeader payloadHeader;
+
+        memcpy(&payloadHeader, payload, sizeof(DepthPayloadHeader));
+
+        int stripes = payloadHeader.stripes;
+        bool delta = payloadHeader.frameType == DepthFrameDelta;
+
+        ok = payloadHeader.width == width &&
+             payloadHeader.height == height &&
+             stripes >= 1 &&
+             stripes <= height &&
+             payloadHeader.headerSize >= sizeof(DepthPayloadHeader) + stripes * sizeof(uint32_t) &&
+             payloadHeader.headerSize <= size &&
+             (payloadHeader.frameType == DepthFrameKey || delta) &&
+             (!delta || ((int)previousDepth.size() == numPixels && previousDepthEnd == frame.offset));
+
+        int offset = payloadHeader.headerSize;
+
+        for(int i = 0; ok && i < stripes; i++)
+        {
+            uint32_t stripeSize;
+
+            memcpy(&stripeSize, payload + sizeof(DepthPayloadHeader) + i * sizeof(uint32_t), sizeof(uint32_t));
+
+            int firstRow = i * height / stripes;
+            int stripePixels = ((i + 1) * height / stripes - firstRow) * width;
+
+            ok = stripeSize <= (uint32_t)(size - offset) &&
+                 CodecRegistry::decodeDepth((CodecId)payloadHeader.codec, payload + offset, stripeSize, &depth[firstRow * width], stripePixels);
+
+            offset += stripeSize;
+        }
+
+        ok = ok && offset == size;
+
+        if(ok && delta)
+        {
+            for(int i = 0; i < numPixels; i++)
+            {
+                depth[i] = depthFromResidual(depth[i], previousDepth[i]);
+            }
+        }
+    }
+
+    if(ok)
+    {
+        KlgIndexEntry entry;
+
+        entry.depthSize = frame.depth.size();
+        entry.imageSize = frame.image.size();
+
+        previousDepth = depth;
+        previousDepthEnd = frame.offset + klgRecordSize(entry, header.version);
+    }
+    else
+    {
+        previousDepthEnd = -1;
+    }
+
+    return ok;
+}
+
+bool KlgReader::decodeImage(const KlgFrame & frame, std::vector<uint8_t> & rgb)
+{
+    int width = header.image.width;
+    int height = header.image.height;
+    int numPixels = width * height;
+    int size = frame.image.size();
+    const uint8_t * payload = size ? &frame.image[0] : 0;
+    CodecId codec = (CodecId)header.image.codec;
+
+    if(numPixels <= 0)
+    {
+        return false;
+    }
+
+    rgb.resize(numPixels * 3);
+
+    switch(header.image.pixelFormat)
+    {
+        case KlgPixelRgb888:
+            return CodecRegistry::decodeImage(codec, payload, size, &rgb[0], width, height, 3);
+        case KlgPixelYuv422:
+            if(codec == CodecJpeg)
+            {
+                /**
+                 * Encoded from YCbCr, so it decodes in true channel order,
+                 * which decodeImage hands back swapped
+                 */
+                if(!CodecRegistry::decodeImage(codec, payload, size, &rgb[0], width, height, 3))
+                {
+                    return false;
+                }
+
+                for(int i = 0; i < numPixels * 3; i += 3)
+                {
+                    std::swap(rgb[i], rgb[i + 2]);
+                }
+
+                return true;
+            }
+
+            storedImage.resize(numPixels * 2);
+
+            if(width % 2 || !CodecRegistry::decodeImage(codec, payload, size, &storedImage[0], width, height, 2))
+            {
+                return false;
+            }
+
+            uyvyToRgb(&storedImage[0], numPixels, &rgb[0]);
+
+            return true;
+        case KlgPixelBayerGrbg8:
+            storedImage.resize(numPixels);
+
+            if(width % 2 || !CodecRegistry::decodeImage(codec, payload, size, &storedImage[0], width / 2, height, 2))
+            {
+                return false;
+            }
+
+            debayerGrbg(&storedImage[0], width, height, &rgb[0]);
+
+            return true;
+        default:
+            return false;
+    }
+}
+
+int64_t KlgReader::tell() const
+{
+    return file ? klgTell(file) : -1;
+}
+
+bool KlgReader::seek(int64_t offset)
+{
+    return file && klgSeek(file, offset, SEEK_SET) == 0;
+}
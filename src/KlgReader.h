@@ -0,0 +1,162 @@
+/*
+ * KlgReader.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef KLGREADER_H_
+#define KLGREADER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/crc.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "KlgFormat.h"
+
+/**
+ * One frame record as stored, depth still carrying its DepthPayloadHeader
+ * (if any) and both streams still encoded
+ */
+struct KlgFrame
+{
+    /**
+     * File offset of the record
+     */
+    int64_t offset;
+    int64_t timestamp;
+    std::vector<uint8_t> depth;
+    std::vector<uint8_t> image;
+};
+
+/**
+ * Reads version 1, 2 and 3 files. Either way getHeader() describes the file,
+ * for version 1 filled in with what that format implies (640x480, zlib
+ * depth, JPEG RGB) and zero calibration and device identity
+ */
+class KlgReader : public boost::noncopyable
+{
+    public:
+        KlgReader();
+        virtual ~KlgReader();
+
+        /**
+         * Returns false if the file can't be opened or isn't a log of a
+         * version this reader knows
+         */
+        bool open(const std::string & filename);
+        void close();
+
+        const KlgHeader & getHeader() const
+        {
+            return header;
+        }
+
+        int getVersion() const
+        {
+            return header.version;
+        }
+
+        /**
+         * Reads the next frame record. Returns false at the end of the file
+         * and on a truncated or corrupt record, leaving the file where the
+         * record started. From version 3 on corrupt includes a CRC mismatch.
+         * numFrames is only checkpointed while recording, so reading until
+         * this fails is the reliable way to get every frame
+         */
+        bool readFrame(KlgFrame & frame);
+
+        /**
+         * Same, also filling in the record's index entry
+         */
+        bool readFrame(KlgFrame & frame, KlgIndexEntry & entry);
+
+        /**
+         * Like readFrame() but only fills in where the record is and what it
+         * holds, skipping over the data. The CRC isn't checked
+         */
+        bool skipFrame(KlgIndexEntry & entry);
+
+        /**
+         * Whether the file ends with a valid index footer, only then can
+         * frames be read by number
+         */
+        bool hasIndex() const
+        {
+            return dataEnd >= 0;
+        }
+
+        const std::vector<KlgIndexEntry> & getIndex() const
+        {
+            return index;
+        }
+
+        bool readFrame(int frameNumber, KlgFrame & frame);
+
+        /**
+         * Decodes a frame's depth, whatever its codec and striping, into
+         * the 16 bit pixels of the header's depth resolution. Delta frames
+         * are applied to the depth of the record just before them, which
+         * has to have been decoded by the last call (see the payload's
+         * keyframeIndex for where to start). Returns false on corrupt data,
+         * a codec that isn't compiled in, or a delta frame whose reference
+         * wasn't decoded
+         */
+        bool decodeDepth(const KlgFrame & frame, std::vector<uint16_t> & depth);
+
+        /**
+         * Decodes a frame's image, whatever its codec and pixel format, into
+         * packed 8 bit RGB (in that order) of the header's image resolution.
+         * Bayer mosaics are debayered bilinearly and YUV 4:2:2 is converted
+         * the way ImageYUV422 does it. Returns false on corrupt data or a
+         * codec that isn't compiled in
+         */
+        bool decodeImage(const KlgFrame & frame, std::vector<uint8_t> & rgb);
+
+        /**
+         * File offset of the next record, of the first one, and where the
+         * records end (the index footer, or the end of the file)
+         */
+        int64_t tell() const;
+        int64_t firstFrameOffset() const
+        {
+            return firstFrame;
+        }
+
+        int64_t framesEndOffset() const
+        {
+            return dataEnd >= 0 ? dataEnd : fileSize;
+        }
+
+        bool seek(int64_t offset);
+
+    private:
+        bool loadIndex();
+        bool readRecordHeader(KlgIndexEntry & entry);
+
+        FILE * file;
+        KlgHeader header;
+        int64_t firstFrame;
+        int64_t fileSize;
+        int64_t dataEnd;
+        std::vector<KlgIndexEntry> index;
+
+        /**
+         * Depth of the last frame decodeDepth() succeeded on, and where its
+         * record ends (-1 if none)
+         */
+        std::vector<uint16_t> previousDepth;
+        int64_t previousDepthEnd;
+
+        /**
+         * Bayer or UYVY image as stored, before conversion to RGB
+         */
+        std::vector<uint8_t> storedImage;
+};
+
+#endif /* KLGREADER_H_ */
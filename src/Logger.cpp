@@ -7,35 +7,64 @@
 
 #include "Logger.h"
 
-Logger::Logger()
- : lastWritten(-1),
+Logger::Logger(const LoggerOptions & options)
+ : options(options),
+   imageFormat(KlgPixelRgb888),
+   slotFormat(KlgPixelRgb888),
+   debayeringMethod(openni_wrapper::ImageBayerGRBG::EdgeAwareWeighted),
+   frameRing(options.ringCapacity, depthBytes),
+   imageRing(options.ringCapacity, imageBytes),
+   droppedFrames(0),
    writeThread(0)
 {
     std::string deviceId = "#1";
 
-    depth_compress_buf_size = 640 * 480 * sizeof(int16_t) * 4;
-    depth_compress_buf = (uint8_t*)malloc(depth_compress_buf_size);
+    encoderPool = new EncoderPool(options.encoderThreads);
 
-    encodedImage = 0;
+    /**
+     * Images are converted on the OpenNI image thread, which at SXGA needs
+     * help to keep up with the frame rate
+     */
+    assert(options.imageThreads > 0);
 
-    writing.assignValue(false);
+    openni_wrapper::RowBandPool::setThreads(options.imageThreads);
+
+    /**
+     * Frames are encoded straight out of the ring, so it has to be able to
+     * hold every frame in flight plus the ones arriving meanwhile
+     */
+    assert(options.framesInFlight > 0 && options.framesInFlight < options.ringCapacity);
 
-    latestDepthIndex.assignValue(-1);
-    latestImageIndex.assignValue(-1);
+    assert(options.depthStripes > 0 && options.depthStripes <= 480);
 
-    for(int i = 0; i < 10; i++)
+    /**
+     * Each depth stripe compresses into its own worst case sized region of
+     * the output buffer, the writer stitches them together
+     */
+    boost::scoped_ptr<DepthEncoder> boundEncoder(CodecRegistry::createDepthEncoder(options.depthCodec, options.depthLevel));
+
+    assert(boundEncoder && CodecRegistry::find(ImageStream, options.imageCodec));
+
+    depthStripeOffsets.push_back(0);
+
+    for(int i = 0; i < options.depthStripes; i++)
     {
-        uint8_t * newImage = (uint8_t *)calloc(640 * 480 * 3, sizeof(uint8_t));
-        imageBuffers[i] = std::pair<uint8_t *, int64_t>(newImage, 0);
+        int stripePixels = ((i + 1) * 480 / options.depthStripes - i * 480 / options.depthStripes) * 640;
+        depthStripeOffsets.push_back(depthStripeOffsets.back() + boundEncoder->bound(stripePixels));
     }
 
-    for(int i = 0; i < 10; i++)
+    for(int i = 0; i < options.framesInFlight; i++)
     {
-        uint8_t * newDepth = (uint8_t *)calloc(640 * 480 * 2, sizeof(uint8_t));
-        uint8_t * newImage = (uint8_t *)calloc(640 * 480 * 3, sizeof(uint8_t));
-        frameBuffers[i] = std::pair<std::pair<uint8_t *, uint8_t *>, int64_t>(std::pair<uint8_t *, uint8_t *>(newDepth, newImage), 0);
+        EncodedFrame * frame = new EncodedFrame;
+        frame->depth.resize(depthStripeOffsets.back());
+        frame->depthStripeSizes.resize(options.depthStripes);
+        frame->image.resize(imageBytes);
+        encodedFrames.push_back(frame);
     }
 
+    writing.assignValue(false);
+    writerWakeups.assignValue(0);
+
     setupDevice(deviceId);
 }
 
@@ -47,26 +76,16 @@ Logger::~Logger()
         m_device->stopImageStream();
     }
 
-    free(depth_compress_buf);
-
-    writing.assignValue(false);
-
-    writeThread->join();
-
-    if(encodedImage != 0)
+    if(writeThread)
     {
-        cvReleaseMat(&encodedImage);
+        stopWriting();
     }
 
-    for(int i = 0; i < 10; i++)
-    {
-        free(imageBuffers[i].first);
-    }
+    delete encoderPool;
 
-    for(int i = 0; i < 10; i++)
+    for(size_t i = 0; i < encodedFrames.size(); i++)
     {
-        free(frameBuffers[i].first.first);
-        free(frameBuffers[i].first.second);
+        delete encodedFrames[i];
     }
 }
 
@@ -136,6 +155,53 @@ void Logger::setupDevice(const std::string & deviceId)
                  % m_device->getSerialNumber()
                  << std::endl;
 
+    if(options.rawBayer)
+    {
+        if(m_device->image_generator_.GetPixelFormat() == XN_PIXEL_FORMAT_GRAYSCALE_8_BIT)
+        {
+            imageFormat = KlgPixelBayerGrbg8;
+        }
+        else
+        {
+            std::cout << "Device has no Bayer output, recording RGB" << std::endl;
+        }
+    }
+
+    if(options.nativeYuv)
+    {
+        if(m_device->image_generator_.GetPixelFormat() == XN_PIXEL_FORMAT_YUV422)
+        {
+            imageFormat = KlgPixelYuv422;
+        }
+        else
+        {
+            std::cout << "Device has no YUV output, recording RGB" << std::endl;
+        }
+    }
+
+    slotFormat = imageFormat;
+
+    /**
+     * A Bayer device recording JPEG keeps the mosaic in the ring as well,
+     * the encoders debayer it in bands fed straight to the compressor and
+     * a full RGB frame is only made when the preview draws one
+     */
+    boost::shared_ptr<openni_wrapper::DeviceKinect> kinect = boost::dynamic_pointer_cast<openni_wrapper::DeviceKinect>(m_device);
+
+    if(imageFormat == KlgPixelRgb888 &&
+       options.imageCodec == CodecJpeg &&
+       kinect &&
+       m_device->image_generator_.GetPixelFormat() == XN_PIXEL_FORMAT_GRAYSCALE_8_BIT)
+    {
+        slotFormat = KlgPixelBayerGrbg8;
+        debayeringMethod = kinect->getDebayeringMethod();
+    }
+
+    if(options.legacyKlg && !legacyFormat())
+    {
+        std::cout << "The legacy format can't describe these codecs, writing a KlgHeader" << std::endl;
+    }
+
     m_device->registerImageCallback(&Logger::imageCallback, *this);
     m_device->registerDepthCallback(&Logger::depthCallback, *this);
 
@@ -166,22 +232,182 @@ void Logger::stopSynchronization()
     }
 }
 
-void Logger::encodeJpeg(cv::Vec<unsigned char, 3> * rgb_data)
+bool Logger::depthHeaderless() const
+{
+    /**
+     * Plain zlib keeps the original headerless format
+     */
+    return options.depthCodec == CodecZlib && !options.keyframeInterval && options.depthStripes == 1;
+}
+
+bool Logger::legacyFormat() const
+{
+    /**
+     * Only on request, and only if the original zlib + JPEG format can
+     * describe the recording
+     */
+    return options.legacyKlg && depthHeaderless() && options.imageCodec == CodecJpeg && imageFormat == KlgPixelRgb888;
+}
+
+void Logger::compressDepth(EncodedFrame * frame, int stripe, EncoderScratch & scratch)
+{
+    int firstRow = stripe * 480 / options.depthStripes;
+    int numPixels = ((stripe + 1) * 480 / options.depthStripes - firstRow) * 640;
+
+    const uint16_t * depth = reinterpret_cast<const uint16_t *>(frame->source) + firstRow * 640;
+
+    if(frame->reference)
+    {
+        const uint16_t * reference = reinterpret_cast<const uint16_t *>(frame->reference) + firstRow * 640;
+
+        scratch.depthResidual.resize(640 * 480);
+
+        for(int i = 0; i < numPixels; i++)
+        {
+            scratch.depthResidual[i] = depthResidual(depth[i], reference[i]);
+        }
+
+        depth = &scratch.depthResidual[0];
+    }
+
+    uint8_t * data = &frame->depth[depthStripeOffsets[stripe]];
+    int capacity = depthStripeOffsets[stripe + 1] - depthStripeOffsets[stripe];
+
+    if(!scratch.depthEncoder)
+    {
+        scratch.depthEncoder.reset(CodecRegistry::createDepthEncoder(options.depthCodec, options.depthLevel));
+    }
+
+    scratch.depthEncoder->setLevel(frame->depthLevel);
+
+    frame->depthStripeSizes[stripe] = scratch.depthEncoder->encode(depth, numPixels, data, capacity);
+
+    finishJob(frame);
+}
+
+void Logger::encodeImage(EncodedFrame * frame, EncoderScratch & scratch)
 {
-    cv::Mat3b rgb(480, 640, rgb_data, 1920);
+    if(!scratch.imageEncoder)
+    {
+        scratch.imageEncoder.reset(CodecRegistry::createImageEncoder(options.imageCodec, options.imageLevel));
 
-    IplImage * img = new IplImage(rgb);
+        if(JpegEncoder * jpegEncoder = dynamic_cast<JpegEncoder *>(scratch.imageEncoder.get()))
+        {
+            jpegEncoder->setSubsampling(options.jpegSubsampling);
+        }
+    }
+
+    scratch.imageEncoder->setLevel(frame->imageLevel);
 
-    int jpeg_params[] = {CV_IMWRITE_JPEG_QUALITY, 90, 0};
+    JpegEncoder * jpegEncoder = dynamic_cast<JpegEncoder *>(scratch.imageEncoder.get());
 
-    if(encodedImage != 0)
+    if(slotFormat == KlgPixelBayerGrbg8 && imageFormat == KlgPixelRgb888)
+    {
+        frame->imageSize = encodeBayerJpeg(frame, jpegEncoder, scratch);
+    }
+    else if(imageFormat == KlgPixelYuv422 && jpegEncoder)
+    {
+        frame->imageSize = jpegEncoder->encodeUyvy(frame->imageSource, 640, 480, 640 * 2, frame->image);
+    }
+    else if(imageFormat == KlgPixelYuv422)
     {
-        cvReleaseMat(&encodedImage);
+        frame->imageSize = scratch.imageEncoder->encode(frame->imageSource, 640, 480, 2, 640 * 2, frame->image);
+    }
+    else if(imageFormat == KlgPixelBayerGrbg8)
+    {
+        frame->imageSize = scratch.imageEncoder->encode(frame->imageSource, 320, 480, 2, 640, frame->image);
+    }
+    else
+    {
+        frame->imageSize = scratch.imageEncoder->encode(frame->imageSource, 640, 480, 3, 640 * 3, frame->image);
     }
 
-    encodedImage = cvEncodeImage(".jpg", img, jpeg_params);
+    finishJob(frame);
+}
 
-    delete img;
+int Logger::encodeBayerJpeg(EncodedFrame * frame, JpegEncoder * jpegEncoder, EncoderScratch & scratch)
+{
+    if(!scratch.bayerImage)
+    {
+        scratch.bayerData.reset(new xn::ImageMetaData);
+        scratch.bayerImage.reset(new openni_wrapper::ImageBayerGRBG(scratch.bayerData, debayeringMethod));
+    }
+
+    scratch.bayerData->ReAdjust(640, 480, XN_PIXEL_FORMAT_GRAYSCALE_8_BIT, frame->imageSource);
+
+    /**
+     * One 4:2:0 MCU row at a time, 30KB of RGB that stays in cache between
+     * the debayer writing it and libjpeg reading it
+     */
+    return jpegEncoder->encodeRows(boost::bind(&openni_wrapper::ImageBayerGRBG::fillRGBBand, scratch.bayerImage.get(), _1, _2, _3, _4),
+                                   640, 480, 16, frame->image);
+}
+
+bool Logger::writeRecordData(BlockWriter & output, boost::crc_32_type & crc, const void * data, size_t size)
+{
+    crc.process_bytes(data, size);
+
+    return output.write(data, size);
+}
+
+void Logger::writeFailed(int32_t numFrames)
+{
+    std::cout << boost::format("Failed writing %s after %d frames, recording stopped") % filename % numFrames << std::endl;
+
+    writing.assignValue(false);
+}
+
+void Logger::finishJob(EncodedFrame * frame)
+{
+    /**
+     * pending starts one above the number of jobs, the last job to finish
+     * drops it to 1 and hands the frame over to the writer
+     */
+    if(--frame->pending == 1)
+    {
+        frame->depthSize = depthHeaderless() ? 0 : sizeof(DepthPayloadHeader) + options.depthStripes * sizeof(uint32_t);
+
+        for(int i = 0; i < options.depthStripes; i++)
+        {
+            if(frame->depthStripeSizes[i] < 0)
+            {
+                frame->depthSize = -1;
+                break;
+            }
+
+            frame->depthSize += frame->depthStripeSizes[i];
+        }
+
+        /**
+         * The encoders read straight out of the ring slot, if the depth thread
+         * lapped the ring in the meantime the output may be torn
+         */
+        frame->intact = frame->depthSize >= 0 &&
+                        frame->imageSize >= 0 &&
+                        frameRing.validate(frame->sequence) == FrameRing::FrameOk &&
+                        imageRing.validate(frame->imageSequence) == FrameRing::FrameOk &&
+                        (!frame->reference || frameRing.validate(frame->referenceSequence) == FrameRing::FrameOk);
+
+        frame->encodeTime = (boost::posix_time::microsec_clock::local_time() - frame->dispatched).total_microseconds();
+
+        frame->pending = 0;
+
+        writerWakeups.incrementAndNotifyAll();
+    }
+}
+
+void Logger::reportDropped(uint64_t first, uint64_t last, const char * reason)
+{
+    droppedFrames += last - first + 1;
+
+    if(first == last)
+    {
+        std::cout << boost::format("Dropped frame %d: %s") % first % reason << std::endl;
+    }
+    else
+    {
+        std::cout << boost::format("Dropped frames %d-%d: %s") % first % last % reason << std::endl;
+    }
 }
 
 void Logger::imageCallback(boost::shared_ptr<openni_wrapper::Image> image, void * cookie)
@@ -190,13 +416,21 @@ void Logger::imageCallback(boost::shared_ptr<openni_wrapper::Image> image, void
     boost::posix_time::time_duration duration(time.time_of_day());
 	m_lastImageTime = duration.total_microseconds();
 
-    int bufferIndex = (latestImageIndex.getValue() + 1) % 10;
-
-    image->fillRGB(image->getWidth(), image->getHeight(), reinterpret_cast<unsigned char*>(imageBuffers[bufferIndex].first), 640 * 3);
+    uint8_t * rgb = imageRing.beginWrite();
 
-    imageBuffers[bufferIndex].second = m_lastImageTime;
+    /**
+     * Raw formats are converted to RGB for the preview only, when it draws
+     */
+    if(slotFormat != KlgPixelRgb888)
+    {
+        image->fillRaw(reinterpret_cast<unsigned char*>(rgb));
+    }
+    else
+    {
+        image->fillRGB(image->getWidth(), image->getHeight(), reinterpret_cast<unsigned char*>(rgb), 640 * 3);
+    }
 
-    latestImageIndex++;
+    imageRing.publish(m_lastImageTime);
 }
 
 void Logger::depthCallback(boost::shared_ptr<openni_wrapper::DepthImage> depth_image, void * cookie)
@@ -204,25 +438,19 @@ void Logger::depthCallback(boost::shared_ptr<openni_wrapper::DepthImage> depth_i
 	boost::posix_time::ptime time = boost::posix_time::microsec_clock::local_time();
     boost::posix_time::time_duration duration(time.time_of_day());
 	m_lastDepthTime = duration.total_microseconds();
-    
-	int bufferIndex = (latestDepthIndex.getValue() + 1) % 10;
-
-    depth_image->fillDepthImageRaw(depth_image->getWidth(), depth_image->getHeight(), reinterpret_cast<unsigned short *>(frameBuffers[bufferIndex].first.first), 640 * 2);
-
-    frameBuffers[bufferIndex].second = m_lastDepthTime;
-
-    int lastImageVal = latestImageIndex.getValue();
 
-    if(lastImageVal == -1)
+    if(imageRing.latest() == 0)
     {
         return;
     }
 
-    lastImageVal %= 10;
+    uint8_t * frame = frameRing.beginWrite();
 
-    memcpy(frameBuffers[bufferIndex].first.second, imageBuffers[lastImageVal].first, 640 * 480 * 3);
+    depth_image->fillDepthImageRaw(depth_image->getWidth(), depth_image->getHeight(), reinterpret_cast<unsigned short *>(frame), 640 * 2);
 
-    latestDepthIndex++;
+    frameRing.publish(m_lastDepthTime, imageRing.latest());
+
+    writerWakeups.incrementAndNotifyAll();
 }
 
 void Logger::startWriting(std::string filename)
@@ -239,84 +467,428 @@ void Logger::startWriting(std::string filename)
 
 void Logger::stopWriting()
 {
-    assert(writeThread && writing.getValue());
+    /**
+     * writing is already false if the writer gave up after an error
+     */
+    assert(writeThread);
 
     writing.assignValue(false);
 
+    writerWakeups.incrementAndNotifyAll();
+
     writeThread->join();
 
+    delete writeThread;
+
     writeThread = 0;
 }
 
 void Logger::writeData()
 {
     /**
-     * int32_t at file beginning for frame count
+     * KlgHeader at file beginning holding the frame count, or just the
+     * int32_t frame count in the legacy format
      */
-    FILE * logFile = fopen(filename.c_str(), "wb+");
+    BlockWriter output;
+
+    if(!output.open(filename, options.writeBlockSize, options.writeBacklogSize, options.preallocateSize, options.directIo))
+    {
+        std::cout << boost::format("Could not open %s for writing") % filename << std::endl;
+
+        writing.assignValue(false);
+
+        return;
+    }
+
+    if(options.directIo && !output.isDirect())
+    {
+        std::cout << boost::format("%s doesn't support O_DIRECT, writing through the page cache") % filename << std::endl;
+    }
 
     int32_t numFrames = 0;
+    int64_t numFramesOffset = 0;
 
-    fwrite(&numFrames, sizeof(int32_t), 1, logFile);
+    /**
+     * Frames covered by the count last written to the file
+     */
+    int32_t checkpointedFrames = 0;
+
+    /**
+     * Appended as a footer when recording stops, see KlgIndexEntry
+     */
+    std::vector<KlgIndexEntry> index;
+    int64_t fileOffset = 0;
 
-    while(writing.getValueWait(1))
+    index.reserve(30 * 60 * 10);
+
+    /**
+     * Without adaptiveLevels this only resolves the starting levels, which
+     * then stay put for the whole recording
+     */
+    AdaptiveController levels(options.depthCodec, options.depthLevel, options.depthLevelMin, options.depthLevelMax,
+                              options.imageCodec, options.imageLevel, options.imageLevelMin, options.imageLevelMax,
+                              options.framesInFlight);
+
+    int version = legacyFormat() ? 1 : klgVersion;
+
+    /**
+     * Set on the first write that fails, from then on nothing more is
+     * written and whatever is still being encoded is dropped
+     */
+    bool failed = false;
+
+    if(legacyFormat())
+    {
+        failed = !output.write(&numFrames, sizeof(int32_t));
+
+        fileOffset = sizeof(int32_t);
+    }
+    else
     {
-        int lastDepth = latestDepthIndex.getValue();
+        /**
+         * Levels are informational, decoding never depends on them
+         */
+        KlgHeader header;
+
+        initKlgHeader(header);
+        initKlgStreamDescriptor(header.depth, 640, 480, KlgPixelDepth16, options.depthCodec, levels.getDepthLevel());
+        initKlgStreamDescriptor(header.image, 640, 480, imageFormat, options.imageCodec, levels.getImageLevel());
+
+        header.depthFocalLength = m_device->getDepthFocalLength(640);
+        header.imageFocalLength = m_device->getImageFocalLength(640);
+        header.baseline = m_device->getBaseline();
+        header.vendorId = m_device->getVendorID();
+        header.productId = m_device->getProductID();
+
+        setKlgIdentity(header.vendorName, m_device->getVendorName());
+        setKlgIdentity(header.productName, m_device->getProductName());
+        setKlgIdentity(header.serialNumber, m_device->getSerialNumber());
+
+        failed = !output.write(&header, sizeof(KlgHeader));
 
-        if(lastDepth == -1)
+        numFramesOffset = offsetof(KlgHeader, numFrames);
+
+        fileOffset = sizeof(KlgHeader);
+    }
+
+    if(failed)
+    {
+        writeFailed(numFrames);
+    }
+
+    std::vector<EncodedFrame *> idleFrames = encodedFrames;
+    std::deque<EncodedFrame *> reorderBuffer;
+
+    /**
+     * Every frame published from here on gets encoded. Frames are only lost
+     * if the depth thread laps the ring before the writer gets to them, or
+     * while an encoder is still reading them
+     */
+    uint64_t nextSequence = std::max(frameRing.latest(), (uint64_t)1);
+
+    droppedFrames = 0;
+
+    /**
+     * Delta frames reference the previous sequence, which has to make it into
+     * the file too. If it does not, its dependants are dropped and the chain
+     * restarts at the next keyframe
+     */
+    uint64_t lastSubmitted = 0;
+    uint64_t lastCommitted = 0;
+    uint32_t lastKeyframeIndex = 0;
+    int framesSinceKeyframe = 0;
+    bool forceKeyframe = true;
+
+    /**
+     * Sleeps until the depth callback publishes a frame, an encoder finishes
+     * or stopWriting() is called. The wakeup count is sampled before anything
+     * is checked so an event in between is never missed. Frames still being
+     * encoded when writing stops are drained before the file is closed
+     */
+    uint64_t lastWakeup = writerWakeups.getValue();
+
+    while(writing.getValue() || !reorderBuffer.empty())
+    {
+        bool progress = false;
+
+        uint64_t lastDepth = frameRing.latest();
+        uint64_t firstLost = 0;
+
+        while(writing.getValue() && nextSequence <= lastDepth && !idleFrames.empty())
         {
-            continue;
-        }
+            EncodedFrame * frame = idleFrames.back();
+            int64_t tag, imageTime, imageTag;
+
+            /**
+             * The image is read straight out of the image ring slot the depth
+             * frame was tagged with, which has to survive encoding as well
+             */
+            if(frameRing.peek(nextSequence, frame->source, frame->timestamp, tag) == FrameRing::FrameOk &&
+               imageRing.peek(tag, frame->imageSource, imageTime, imageTag) == FrameRing::FrameOk)
+            {
+                if(firstLost)
+                {
+                    reportDropped(firstLost, nextSequence - 1, "overwritten before encoding");
+                    firstLost = 0;
+                }
+
+                if(options.adaptiveLevels)
+                {
+                    levels.update(nextSequence, reorderBuffer.size(), droppedFrames);
+                }
+
+                idleFrames.pop_back();
+
+                frame->sequence = nextSequence;
+                frame->imageSequence = tag;
+                frame->depthLevel = levels.getDepthLevel();
+                frame->imageLevel = levels.getImageLevel();
+                frame->dispatched = boost::posix_time::microsec_clock::local_time();
+                frame->pending = options.depthStripes + 1 + 1;
+                frame->reference = 0;
+
+                if(options.keyframeInterval > 0 &&
+                   !forceKeyframe &&
+                   framesSinceKeyframe < options.keyframeInterval &&
+                   lastSubmitted == nextSequence - 1)
+                {
+                    int64_t referenceTime, referenceTag;
+
+                    if(frameRing.peek(nextSequence - 1, frame->reference, referenceTime, referenceTag) != FrameRing::FrameOk)
+                    {
+                        frame->reference = 0;
+                    }
+
+                    frame->referenceSequence = nextSequence - 1;
+                }
+
+                framesSinceKeyframe = frame->reference ? framesSinceKeyframe + 1 : 1;
+                forceKeyframe = false;
+                lastSubmitted = nextSequence;
+
+                for(int i = 0; i < options.depthStripes; i++)
+                {
+                    encoderPool->submit(boost::bind(&Logger::compressDepth, this, frame, i, _1));
+                }
+
+                encoderPool->submit(boost::bind(&Logger::encodeImage, this, frame, _1));
+
+                reorderBuffer.push_back(frame);
+            }
+            else if(!firstLost)
+            {
+                firstLost = nextSequence;
+            }
 
-        int bufferIndex = lastDepth % 10;
+            nextSequence++;
+            progress = true;
+        }
 
-        if(bufferIndex == lastWritten)
+        if(firstLost)
         {
-            continue;
+            reportDropped(firstLost, nextSequence - 1, "overwritten before encoding");
         }
 
-        unsigned long compressed_size = depth_compress_buf_size;
-        boost::thread_group threads;
+        /**
+         * Encoders finish out of order, frames are committed in sequence
+         * (and therefore timestamp) order from the head of the buffer
+         */
+        while(!reorderBuffer.empty() && reorderBuffer.front()->pending == 0)
+        {
+            EncodedFrame * frame = reorderBuffer.front();
+
+            reorderBuffer.pop_front();
 
-        threads.add_thread(new boost::thread(compress2,
-                                             depth_compress_buf,
-                                             &compressed_size,
-                                             (const Bytef*)frameBuffers[bufferIndex].first.first,
-                                             640 * 480 * sizeof(short),
-                                             Z_BEST_SPEED));
+            levels.frameEncoded(frame->timestamp, frame->encodeTime);
 
-        threads.add_thread(new boost::thread(boost::bind(&Logger::encodeJpeg,
-                                                         this,
-                                                         (cv::Vec<unsigned char, 3> *)frameBuffers[bufferIndex].first.second)));
+            bool referenceLost = frame->reference && lastCommitted != frame->referenceSequence;
 
-        threads.join_all();
+            if(frame->intact && !referenceLost && !failed)
+            {
+                if(!frame->reference)
+                {
+                    lastKeyframeIndex = numFrames;
+                }
+
+                KlgIndexEntry entry;
+
+                entry.timestamp = frame->timestamp;
+                entry.offset = fileOffset;
+                entry.depthSize = frame->depthSize;
+                entry.imageSize = frame->imageSize;
+
+                index.push_back(entry);
+
+                fileOffset += klgRecordSize(entry, version);
+
+                /**
+                 * Format is:
+                 * int64_t: timestamp
+                 * int32_t: depthSize
+                 * int32_t: imageSize
+                 * depthSize * unsigned char: depth, either a bare zlib stream or
+                 *                            a DepthPayloadHeader naming the codec
+                 *                            and frame type followed by its data
+                 *                            (DepthFormat.h)
+                 * imageSize * unsigned char: RGB (or the raw Bayer mosaic) encoded
+                 *                            with the image codec, JPEG unless the
+                 *                            KlgHeader says otherwise
+                 * uint32_t: CRC-32 of all of the above, from version 3 on
+                 *
+                 * The last record is followed by the index footer (KlgFormat.h)
+                 */
+                boost::crc_32_type crc;
+
+                bool written = writeRecordData(output, crc, &frame->timestamp, sizeof(int64_t)) &&
+                               writeRecordData(output, crc, &frame->depthSize, sizeof(int32_t)) &&
+                               writeRecordData(output, crc, &frame->imageSize, sizeof(int32_t));
+
+                if(depthHeaderless())
+                {
+                    written = written && writeRecordData(output, crc, &frame->depth[0], frame->depthSize);
+                }
+                else
+                {
+                    DepthPayloadHeader header;
+
+                    initDepthPayloadHeader(header, options.depthCodec, frame->reference ? DepthFrameDelta : DepthFrameKey, 640, 480, options.depthStripes);
+
+                    header.keyframeIndex = lastKeyframeIndex;
+
+                    written = written &&
+                              writeRecordData(output, crc, &header, sizeof(DepthPayloadHeader)) &&
+                              writeRecordData(output, crc, &frame->depthStripeSizes[0], sizeof(int32_t) * options.depthStripes);
+
+                    for(int i = 0; i < options.depthStripes; i++)
+                    {
+                        written = written && writeRecordData(output, crc, &frame->depth[depthStripeOffsets[i]], frame->depthStripeSizes[i]);
+                    }
+                }
+
+                written = written && writeRecordData(output, crc, &frame->image[0], frame->imageSize);
+
+                if(written && klgHasRecordCrc(version))
+                {
+                    uint32_t checksum = crc.checksum();
+
+                    written = output.write(&checksum, sizeof(uint32_t));
+                }
+
+                if(!written)
+                {
+                    index.pop_back();
+
+                    writeFailed(numFrames);
+
+                    failed = true;
+                    idleFrames.push_back(frame);
+                    progress = true;
+                    continue;
+                }
+
+                levels.frameWritten(frame->sequence, numFrames);
+
+                numFrames++;
+
+                /**
+                 * Only records whose block has gone out are counted, so the
+                 * count never covers one that isn't in the file yet
+                 */
+                int32_t flushedFrames = checkpointedFrames;
+
+                while(flushedFrames < numFrames &&
+                      index[flushedFrames].offset + klgRecordSize(index[flushedFrames], version) <= output.flushedOffset())
+                {
+                    flushedFrames++;
+                }
+
+                if(options.checkpointInterval > 0 && flushedFrames - checkpointedFrames >= options.checkpointInterval)
+                {
+                    if(!output.patch(numFramesOffset, &flushedFrames, sizeof(int32_t)))
+                    {
+                        writeFailed(numFrames);
+
+                        failed = true;
+                    }
+
+                    checkpointedFrames = flushedFrames;
+                }
+
+                lastCommitted = frame->sequence;
+            }
+            else
+            {
+                const char * reason = failed ? "writing stopped after an error" :
+                                      frame->depthSize < 0 ? "depth compression failed" :
+                                      frame->imageSize < 0 ? "image encoding failed" :
+                                      !frame->intact ? "overwritten during encoding" :
+                                                       "reference frame dropped";
 
-        int32_t depthSize = compressed_size;
-        int32_t imageSize = encodedImage->width;
+                reportDropped(frame->sequence, frame->sequence, reason);
 
-        /**
-         * Format is:
-         * int64_t: timestamp
-         * int32_t: depthSize
-         * int32_t: imageSize
-         * depthSize * unsigned char: depth_compress_buf
-         * imageSize * unsigned char: encodedImage->data.ptr
-         */
+                forceKeyframe = true;
+            }
+
+            idleFrames.push_back(frame);
+            progress = true;
+        }
 
-        fwrite(&frameBuffers[bufferIndex].second, sizeof(int64_t), 1, logFile);
-        fwrite(&depthSize, sizeof(int32_t), 1, logFile);
-        fwrite(&imageSize, sizeof(int32_t), 1, logFile);
-        fwrite(depth_compress_buf, depthSize, 1, logFile);
-        fwrite(encodedImage->data.ptr, imageSize, 1, logFile);
+        if(!progress)
+        {
+            lastWakeup = writerWakeups.waitForChange(lastWakeup);
+        }
+    }
 
-        numFrames++;
+    std::cout << boost::format("Wrote %d frames to %s, dropped %d") % numFrames % filename % droppedFrames << std::endl;
 
-        lastWritten = bufferIndex;
+    /**
+     * Misses past the first few frames mean the capture threads are still
+     * allocating, i.e. frames are being held on to somewhere
+     */
+    unsigned long depthHits, depthMisses, imageHits, imageMisses;
+
+    m_device->getDepthPoolCounters(depthHits, depthMisses);
+    m_device->getImagePoolCounters(imageHits, imageMisses);
+
+    std::cout << boost::format("Frame pools: depth %lu reused, %lu allocated, image %lu reused, %lu allocated")
+                 % depthHits % depthMisses % imageHits % imageMisses << std::endl;
+
+    /**
+     * After a failed write the count stays at the last checkpoint and there
+     * is no footer, KlgIndex can recover what made it into the file
+     */
+    if(!failed)
+    {
+        KlgIndexTrailer trailer;
+
+        initKlgIndexTrailer(trailer, fileOffset, index.size());
+
+        failed = (!index.empty() && !output.write(&index[0], sizeof(KlgIndexEntry) * index.size())) ||
+                 !output.write(&trailer, sizeof(KlgIndexTrailer)) ||
+                 !output.patch(numFramesOffset, &numFrames, sizeof(int32_t));
     }
 
-    fseek(logFile, 0, SEEK_SET);
-    fwrite(&numFrames, sizeof(int32_t), 1, logFile);
+    if(!output.close() || failed)
+    {
+        std::cout << boost::format("Failed writing %s, the log is incomplete, run KlgIndex on it to recover it") % filename << std::endl;
+    }
 
-    fflush(logFile);
-    fclose(logFile);
+    /**
+     * Stalls are single block writes that blocked the writer long enough
+     * to back up the encoders
+     */
+    const BlockWriter::Stats & stats = output.getStats();
+
+    std::cout << boost::format("Disk: %.1f MB in %d writes, %.1f MB/s while writing, longest write %.1f ms, %d over %d ms")
+                 % (stats.bytes / 1048576.0)
+                 % stats.writes
+                 % (stats.writeMicroseconds > 0 ? (stats.bytes / 1048576.0) / (stats.writeMicroseconds / 1000000.0) : 0.0)
+                 % (stats.longestWrite / 1000.0)
+                 % stats.stalls
+                 % (BlockWriter::StallMicroseconds / 1000) << std::endl;
+
+    std::cout << boost::format("Writer %s, blocked on the disk for %.1f ms, backlog peaked at %.1f MB")
+                 % (output.isAsync() ? "used io_uring" : "wrote synchronously")
+                 % (stats.blockedMicroseconds / 1000.0)
+                 % (stats.peakBacklog / 1048576.0) << std::endl;
 }
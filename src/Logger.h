@@ -11,11 +11,13 @@
 #include <zlib.h>
 
 #include <limits>
+#include <cstddef>
 #include <cassert>
 #include <iostream>
 
 #include <opencv2/opencv.hpp>
 
+#include <boost/crc.hpp>
 #include <boost/format.hpp>
 #include <boost/thread.hpp>
 #include <boost/lexical_cast.hpp>
@@ -28,46 +30,241 @@
 #include "OpenNI/openni_exception.h"
 #include "OpenNI/openni_depth_image.h"
 #include "OpenNI/openni_image.h"
+#include "OpenNI/openni_image_bayer_grbg.h"
+#include "OpenNI/openni_device_kinect.h"
+#include "OpenNI/openni_row_band_pool.h"
 
 #include "ThreadMutexObject.h"
+#include "FrameRing.h"
+#include "EncoderPool.h"
+#include "DepthFormat.h"
+#include "KlgFormat.h"
+#include "JpegEncoder.h"
+#include "BlockWriter.h"
+#include "AdaptiveController.h"
+
+struct LoggerOptions
+{
+    LoggerOptions()
+     : ringCapacity(10),
+       encoderThreads(2),
+       framesInFlight(4),
+       depthCodec(CodecZlib),
+       depthLevel(-1),
+       keyframeInterval(0),
+       depthStripes(1),
+       imageCodec(CodecJpeg),
+       imageLevel(-1),
+       jpegSubsampling(JpegEncoder::Subsample420),
+       adaptiveLevels(false),
+       depthLevelMin(-1),
+       depthLevelMax(-1),
+       imageLevelMin(-1),
+       imageLevelMax(-1),
+       rawBayer(false),
+       nativeYuv(false),
+       imageThreads(1),
+       legacyKlg(false),
+       checkpointInterval(30),
+       writeBlockSize(4 << 20),
+       writeBacklogSize(64 << 20),
+       preallocateSize(256 << 20),
+       directIo(false)
+    {}
+
+    int ringCapacity;
+    int encoderThreads;
+    int framesInFlight;
+    /**
+     * Codecs as registered in CodecRegistry, a level of -1 is the codec's
+     * default
+     */
+    CodecId depthCodec;
+    int depthLevel;
+    /**
+     * 0 compresses every depth frame on its own, otherwise a keyframe is
+     * written every keyframeInterval frames with residuals against the
+     * previous frame in between
+     */
+    int keyframeInterval;
+    /**
+     * Horizontal stripes each depth frame is split into, each compressed as
+     * a separate encoder job
+     */
+    int depthStripes;
+    CodecId imageCodec;
+    int imageLevel;
+    JpegEncoder::Subsampling jpegSubsampling;
+    /**
+     * Lets AdaptiveController move the codec levels within these bounds
+     * (-1 for the codec's full range) as the encoders fall behind or catch
+     * up, starting from depthLevel and imageLevel
+     */
+    bool adaptiveLevels;
+    int depthLevelMin;
+    int depthLevelMax;
+    int imageLevelMin;
+    int imageLevelMax;
+    /**
+     * Store the Kinect's GRBG mosaic as is instead of debayering it, the
+     * image codec has to be lossless. Ignored for devices without one
+     */
+    bool rawBayer;
+    /**
+     * Keep PrimeSense UYVY frames as delivered, JPEG encodes them without
+     * going through RGB. Ignored for devices with other output
+     */
+    bool nativeYuv;
+    /**
+     * Threads, including the OpenNI image thread, that debayering and
+     * colour conversion of each image are split across in row bands
+     */
+    int imageThreads;
+    /**
+     * Write the original layout, a bare frame count instead of a KlgHeader,
+     * for readers that predate the header. Only possible with zlib depth and
+     * JPEG RGB, and loses the calibration and device identity
+     */
+    bool legacyKlg;
+    /**
+     * Frames between rewrites of the frame count at the start of the file,
+     * so that a recording that is cut short still reads up to the last
+     * checkpoint. 0 only writes it when recording stops
+     */
+    int checkpointInterval;
+    /**
+     * The file is written writeBlockSize bytes at a time, with space
+     * reserved preallocateSize bytes at a time (0 for none) ahead of the
+     * writes. Built with liburing, up to writeBacklogSize bytes of blocks
+     * can be waiting on the disk before the writer thread blocks (0 writes
+     * synchronously). directIo bypasses the page cache, see BlockWriter
+     */
+    int writeBlockSize;
+    int64_t writeBacklogSize;
+    int64_t preallocateSize;
+    bool directIo;
+};
 
 class Logger
 {
     public:
-        Logger();
+        Logger(const LoggerOptions & options = LoggerOptions());
         virtual ~Logger();
 
         void startWriting(std::string filename);
         void stopWriting();
 
-        std::pair<std::pair<uint8_t *, uint8_t *>, int64_t> frameBuffers[10];
-        ThreadMutexObject<int> latestDepthIndex;
+        /**
+         * Turns false by itself if the log can't be written, stopWriting()
+         * still has to be called
+         */
+        bool isWriting()
+        {
+            return writing.getValue();
+        }
+
+        /**
+         * Each frame ring slot holds the raw depth frame, tagged with the
+         * image ring sequence of the image that was current when it arrived.
+         * Images are referenced rather than copied alongside every depth frame
+         */
+        static const int depthBytes = 640 * 480 * 2;
+        static const int imageBytes = 640 * 480 * 3;
+
+        const FrameRing & getFrameRing() const
+        {
+            return frameRing;
+        }
+
+        const FrameRing & getImageRing() const
+        {
+            return imageRing;
+        }
+
+        /**
+         * What each image ring slot holds, packed RGB, the raw Bayer
+         * mosaic in the first 640 * 480 bytes or UYVY in the first
+         * 640 * 480 * 2. Bayer devices recording JPEG hold the mosaic even
+         * though RGB is what gets written
+         */
+        KlgPixelFormat getImageFormat() const
+        {
+            return slotFormat;
+        }
+
+        /**
+         * Frames lost during the current or last recording
+         */
+        int getDroppedFrames() const
+        {
+            return droppedFrames;
+        }
 
     private:
-        std::pair<uint8_t *, int64_t> imageBuffers[10];
-        ThreadMutexObject<int> latestImageIndex;
+        /**
+         * Output of the encoder jobs for one frame, recycled by the writer
+         */
+        struct EncodedFrame
+        {
+            uint64_t sequence;
+            int64_t timestamp;
+            const uint8_t * source;
+            const uint8_t * imageSource;
+            uint64_t imageSequence;
+            const uint8_t * reference;
+            uint64_t referenceSequence;
+            int depthLevel;
+            int imageLevel;
+            boost::posix_time::ptime dispatched;
+            int64_t encodeTime;
+            std::vector<uint8_t> depth;
+            std::vector<int32_t> depthStripeSizes;
+            int32_t depthSize;
+            std::vector<uint8_t> image;
+            int32_t imageSize;
+            boost::atomic<int> pending;
+            bool intact;
+        };
+
+        LoggerOptions options;
+        KlgPixelFormat imageFormat;
+        KlgPixelFormat slotFormat;
+        openni_wrapper::ImageBayerGRBG::DebayeringMethod debayeringMethod;
+
+        FrameRing frameRing;
+        FrameRing imageRing;
+
+        EncoderPool * encoderPool;
+        std::vector<EncodedFrame *> encodedFrames;
+        std::vector<int> depthStripeOffsets;
 
         boost::shared_ptr<openni_wrapper::OpenNIDevice> m_device;
         int64_t m_lastImageTime;
         int64_t m_lastDepthTime;
-        int depth_compress_buf_size;
-        uint8_t * depth_compress_buf;
-        CvMat * encodedImage;
 
-        int lastWritten;
+        boost::atomic<int> droppedFrames;
         boost::thread * writeThread;
         ThreadMutexObject<bool> writing;
+        ThreadMutexObject<uint64_t> writerWakeups;
         std::string filename;
 
         void setupDevice(const std::string & deviceId);
         void startSynchronization();
         void stopSynchronization();
 
-        void encodeJpeg(cv::Vec<unsigned char, 3> * rgb_data);
+        bool depthHeaderless() const;
+        bool legacyFormat() const;
+        void compressDepth(EncodedFrame * frame, int stripe, EncoderScratch & scratch);
+        void encodeImage(EncodedFrame * frame, EncoderScratch & scratch);
+        int encodeBayerJpeg(EncodedFrame * frame, JpegEncoder * jpegEncoder, EncoderScratch & scratch);
+        void finishJob(EncodedFrame * frame);
+        void reportDropped(uint64_t first, uint64_t last, const char * reason);
         void imageCallback(boost::shared_ptr<openni_wrapper::Image> image, void * cookie);
         void depthCallback(boost::shared_ptr<openni_wrapper::DepthImage> depth_image, void * cookie);
 
         void writeData();
+        void writeFailed(int32_t numFrames);
+        static bool writeRecordData(BlockWriter & output, boost::crc_32_type & crc, const void * data, size_t size);
 };
 
 #endif /* LOGGER_H_ */
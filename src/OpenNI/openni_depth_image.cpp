@@ -35,6 +35,7 @@
  *
  */
 #include "openni_depth_image.h"
+#include "openni_simd.h"
 #include <sstream>
 #include <limits>
 #include <iostream>
@@ -44,6 +45,17 @@ using namespace std;
 namespace openni_wrapper
 {
 
+simd::DepthInvalid DepthImage::getInvalidValues () const throw ()
+{
+  simd::DepthInvalid invalid;
+
+  // 0 is invalid anyway, so stands in for values no pixel can have
+  invalid.no_sample = no_sample_value_ <= numeric_limits<unsigned short>::max () ? (unsigned short) no_sample_value_ : 0;
+  invalid.shadow = shadow_value_ <= numeric_limits<unsigned short>::max () ? (unsigned short) shadow_value_ : 0;
+
+  return invalid;
+}
+
 void DepthImage::fillDepthImageRaw(unsigned width, unsigned height, unsigned short* depth_buffer, unsigned line_step) const throw (OpenNIException)
 {
   if (width > depth_md_->XRes () || height > depth_md_->YRes ())
@@ -69,13 +81,26 @@ void DepthImage::fillDepthImageRaw(unsigned width, unsigned height, unsigned sho
   unsigned xStep = depth_md_->XRes () / width;
   unsigned ySkip = (depth_md_->YRes () / height - 1) * depth_md_->XRes ();
 
-  // Fill in the depth image data, converting mm to m
-  short bad_point = numeric_limits<short>::quiet_NaN ();
+  // Fill in the depth image data, integers have no NaN so invalid points are 0
+  unsigned short bad_point = 0;
   unsigned depthIdx = 0;
 
+  // SIMD kernel for the bulk of each line, 0 if unavailable
+  const simd::Kernels* kernels = simd::getKernels ();
+  simd::DepthInvalid invalid = getInvalidValues ();
+
   for (unsigned yIdx = 0; yIdx < height; ++yIdx, depthIdx += ySkip)
   {
-    for (unsigned xIdx = 0; xIdx < width; ++xIdx, depthIdx += xStep, ++depth_buffer)
+    unsigned xIdx = 0;
+
+    if (kernels)
+    {
+      xIdx = kernels->depthRawRow (depth_md_->Data () + depthIdx, xStep, invalid, depth_buffer, width);
+      depthIdx += xIdx * xStep;
+      depth_buffer += xIdx;
+    }
+
+    for (; xIdx < width; ++xIdx, depthIdx += xStep, ++depth_buffer)
     {
       if ((*depth_md_)[depthIdx] == 0 ||
           (*depth_md_)[depthIdx] == no_sample_value_ ||
@@ -117,9 +142,22 @@ void DepthImage::fillDepthImage (unsigned width, unsigned height, float* depth_b
   float bad_point = numeric_limits<float>::quiet_NaN ();
   unsigned depthIdx = 0;
 
+  // SIMD kernel for the bulk of each line, 0 if unavailable
+  const simd::Kernels* kernels = simd::getKernels ();
+  simd::DepthInvalid invalid = getInvalidValues ();
+
   for (unsigned yIdx = 0; yIdx < height; ++yIdx, depthIdx += ySkip)
   {
-    for (unsigned xIdx = 0; xIdx < width; ++xIdx, depthIdx += xStep, ++depth_buffer)
+    unsigned xIdx = 0;
+
+    if (kernels)
+    {
+      xIdx = kernels->depthRow (depth_md_->Data () + depthIdx, xStep, invalid, depth_buffer, width);
+      depthIdx += xIdx * xStep;
+      depth_buffer += xIdx;
+    }
+
+    for (; xIdx < width; ++xIdx, depthIdx += xStep, ++depth_buffer)
     {
       if ((*depth_md_)[depthIdx] == 0 ||
           (*depth_md_)[depthIdx] == no_sample_value_ ||
@@ -160,16 +198,29 @@ void DepthImage::fillDisparityImage (unsigned width, unsigned height, float* dis
   // focal length is for the native image resolution -> focal_length = focal_length_ / xStep;
   float constant = focal_length_ * baseline_ * 1000.0 / (float) xStep;
 
+  // SIMD kernel for the bulk of each line, 0 if unavailable
+  const simd::Kernels* kernels = simd::getKernels ();
+  simd::DepthInvalid invalid = getInvalidValues ();
+
   for (unsigned yIdx = 0, depthIdx = 0; yIdx < height; ++yIdx, depthIdx += ySkip)
   {
-    for (unsigned xIdx = 0; xIdx < width; ++xIdx, depthIdx += xStep, ++disparity_buffer)
+    unsigned xIdx = 0;
+
+    if (kernels)
+    {
+      xIdx = kernels->disparityRow (depth_md_->Data () + depthIdx, xStep, invalid, constant, disparity_buffer, width);
+      depthIdx += xIdx * xStep;
+      disparity_buffer += xIdx;
+    }
+
+    for (; xIdx < width; ++xIdx, depthIdx += xStep, ++disparity_buffer)
     {
       if ((*depth_md_)[depthIdx] == 0 ||
           (*depth_md_)[depthIdx] == no_sample_value_ ||
           (*depth_md_)[depthIdx] == shadow_value_)
         *disparity_buffer = 0.0;
       else
-        *disparity_buffer = constant / (double) (*depth_md_)[depthIdx];
+        *disparity_buffer = constant / (float) (*depth_md_)[depthIdx];
     }
 
     // if we have padding
@@ -44,6 +44,11 @@
 
 namespace openni_wrapper
 {
+namespace simd
+{
+struct DepthInvalid;
+}
+
 /**
  * @brief This class provides methods to fill a depth or disparity image.
  * @author Suat Gedikli
@@ -72,6 +77,8 @@ public:
   inline unsigned getFrameID () const throw ();
   inline unsigned long getTimeStamp () const throw ();
 protected:
+  simd::DepthInvalid getInvalidValues () const throw ();
+
   boost::shared_ptr<xn::DepthMetaData> depth_md_;
   float baseline_;
   float focal_length_;
@@ -54,6 +54,7 @@ namespace openni_wrapper
 OpenNIDevice::OpenNIDevice (xn::Context& context, const xn::NodeInfo& device_node, const xn::NodeInfo& image_node, const xn::NodeInfo& depth_node, const xn::NodeInfo& ir_node) throw (OpenNIException)
   : context_ (context)
   , device_node_info_ (device_node)
+  , image_unavailable_ (false)
 {
   // create the production nodes
   XnStatus status = context_.CreateProductionTree (const_cast<xn::NodeInfo&>(depth_node));
@@ -92,6 +93,7 @@ OpenNIDevice::OpenNIDevice (xn::Context& context, const xn::NodeInfo& device_nod
 OpenNIDevice::OpenNIDevice (xn::Context& context, const xn::NodeInfo& device_node, const xn::NodeInfo& depth_node, const xn::NodeInfo& ir_node) throw (OpenNIException)
   : context_ (context)
   , device_node_info_ (device_node)
+  , image_unavailable_ (false)
 {
     // create the production nodes
   XnStatus status = context_.CreateProductionTree (const_cast<xn::NodeInfo&>(depth_node));
@@ -122,6 +124,7 @@ OpenNIDevice::OpenNIDevice (xn::Context& context, const xn::NodeInfo& device_nod
 OpenNIDevice::OpenNIDevice (xn::Context& context) throw (OpenNIException)
   : context_ (context)
   , device_node_info_ (0)
+  , image_unavailable_ (false)
 {
 }
 
@@ -503,13 +506,29 @@ void OpenNIDevice::ImageDataThreadFunction () throw (OpenNIException)
       return;
 
     image_generator_.WaitAndUpdateData ();
-    //xn::ImageMetaData* image_data = boost::shared_ptr<xn::ImageMetaData>;
-    boost::shared_ptr<xn::ImageMetaData> image_data (new xn::ImageMetaData);
-    image_generator_.GetMetaData (*image_data);
+    boost::shared_ptr<Image> image;
+
+    // devices that don't wrap their image stream (Xtion Pro) only ever hand out a null image, nothing to pool
+    if (!image_unavailable_)
+    {
+      ImagePool::Slot& slot = image_pool_.acquire ();
+      image_generator_.GetMetaData (*slot.meta_data);
+
+      // created under the lock, so that devices can clear the pool when their image settings change
+      if (!slot.wrapper)
+        slot.wrapper = getCurrentImage (slot.meta_data);
+
+      if (slot.wrapper)
+        image = slot.wrapper;
+      else
+      {
+        image_unavailable_ = true;
+        image_pool_.reset ();
+      }
+    }
 
     image_lock.unlock ();
     
-    boost::shared_ptr<Image> image = getCurrentImage (image_data);
     for (map< OpenNIDevice::CallbackHandle, ActualImageCallbackFunction >::iterator callbackIt = image_callback_.begin (); callbackIt != image_callback_.end (); ++callbackIt)
     {
       callbackIt->second.operator()(image);
@@ -530,11 +549,17 @@ void OpenNIDevice::DepthDataThreadFunction () throw (OpenNIException)
       return;
 
     depth_generator_.WaitAndUpdateData ();
-    boost::shared_ptr<xn::DepthMetaData> depth_data (new xn::DepthMetaData);
-    depth_generator_.GetMetaData (*depth_data);
+    DepthPool::Slot& slot = depth_pool_.acquire ();
+    depth_generator_.GetMetaData (*slot.meta_data);
     depth_lock.unlock ();
     
-    boost::shared_ptr<DepthImage> depth_image ( new DepthImage (depth_data, baseline_, getDepthFocalLength (), shadow_value_, no_sample_value_) );
+    // the focal length changes with the output mode and registration
+    float focal_length = getDepthFocalLength ();
+    if (!slot.wrapper || slot.wrapper->getFocalLength () != focal_length || slot.wrapper->getBaseline () != baseline_ ||
+        slot.wrapper->getShadowValue () != shadow_value_ || slot.wrapper->getNoSampleValue () != no_sample_value_)
+      slot.wrapper.reset (new DepthImage (slot.meta_data, baseline_, focal_length, shadow_value_, no_sample_value_));
+
+    boost::shared_ptr<DepthImage> depth_image = slot.wrapper;
 
     for (map< OpenNIDevice::CallbackHandle, ActualDepthImageCallbackFunction >::iterator callbackIt = depth_callback_.begin ();
          callbackIt != depth_callback_.end (); ++callbackIt)
@@ -557,11 +582,14 @@ void OpenNIDevice::IRDataThreadFunction () throw (OpenNIException)
       return;
 
     ir_generator_.WaitAndUpdateData ();
-    boost::shared_ptr<xn::IRMetaData> ir_data (new xn::IRMetaData);
-    ir_generator_.GetMetaData (*ir_data);
+    IRPool::Slot& slot = ir_pool_.acquire ();
+    ir_generator_.GetMetaData (*slot.meta_data);
     ir_lock.unlock ();
 
-    boost::shared_ptr<IRImage> ir_image ( new IRImage (ir_data) );
+    if (!slot.wrapper)
+      slot.wrapper.reset (new IRImage (slot.meta_data));
+
+    boost::shared_ptr<IRImage> ir_image = slot.wrapper;
 
     for (map< OpenNIDevice::CallbackHandle, ActualIRImageCallbackFunction >::iterator callbackIt = ir_callback_.begin ();
          callbackIt != ir_callback_.end (); ++callbackIt)
@@ -41,6 +41,7 @@
 #include <vector>
 #include <utility>
 #include "openni_exception.h"
+#include "openni_frame_pool.h"
 #include <XnCppWrapper.h>
 #include <boost/noncopyable.hpp>
 #include <boost/function.hpp>
@@ -156,10 +157,18 @@ public:
   unsigned short getProductID () const throw ();
   unsigned char  getBus () const throw ();
   unsigned char  getAddress () const throw ();
+
+  /** \brief frames for which a data thread reused pooled metadata and image objects (hits) or had to allocate them (misses) */
+  inline void getImagePoolCounters (unsigned long& hits, unsigned long& misses) const throw ();
+  inline void getDepthPoolCounters (unsigned long& hits, unsigned long& misses) const throw ();
+  inline void getIRPoolCounters (unsigned long& hits, unsigned long& misses) const throw ();
 protected:
   typedef boost::function<void(boost::shared_ptr<Image>) > ActualImageCallbackFunction;
   typedef boost::function<void(boost::shared_ptr<DepthImage>) > ActualDepthImageCallbackFunction;
   typedef boost::function<void(boost::shared_ptr<IRImage>) > ActualIRImageCallbackFunction;
+  typedef FramePool<xn::ImageMetaData, Image> ImagePool;
+  typedef FramePool<xn::DepthMetaData, DepthImage> DepthPool;
+  typedef FramePool<xn::IRMetaData, IRImage> IRPool;
 
   OpenNIDevice (xn::Context& context, const xn::NodeInfo& device_node, const xn::NodeInfo& image_node, const xn::NodeInfo& depth_node, const xn::NodeInfo& ir_node) throw (OpenNIException);
   OpenNIDevice (xn::Context& context, const xn::NodeInfo& device_node, const xn::NodeInfo& depth_node, const xn::NodeInfo& ir_node) throw (OpenNIException);
@@ -233,6 +242,12 @@ protected:
   boost::thread image_thread_;
   boost::thread depth_thread_;
   boost::thread ir_thread_;
+  /** per frame objects recycled by the data threads, the image pool is only touched under image_mutex_ */
+  ImagePool image_pool_;
+  DepthPool depth_pool_;
+  IRPool ir_pool_;
+  /** set once getCurrentImage returned no image, from then on the image pool is skipped */
+  bool image_unavailable_;
 };
 
 float OpenNIDevice::getImageFocalLength (int output_x_resolution) const throw ()
@@ -261,6 +276,24 @@ float OpenNIDevice::getBaseline () const throw ()
   return baseline_;
 }
 
+void OpenNIDevice::getImagePoolCounters (unsigned long& hits, unsigned long& misses) const throw ()
+{
+  hits = image_pool_.getHits ();
+  misses = image_pool_.getMisses ();
+}
+
+void OpenNIDevice::getDepthPoolCounters (unsigned long& hits, unsigned long& misses) const throw ()
+{
+  hits = depth_pool_.getHits ();
+  misses = depth_pool_.getMisses ();
+}
+
+void OpenNIDevice::getIRPoolCounters (unsigned long& hits, unsigned long& misses) const throw ()
+{
+  hits = ir_pool_.getHits ();
+  misses = ir_pool_.getMisses ();
+}
+
 template<typename T> OpenNIDevice::CallbackHandle OpenNIDevice::registerImageCallback (void (T::*callback)(boost::shared_ptr<Image>, void* cookie), T& instance, void* custom_data) throw ()
 {
   image_callback_[image_callback_handle_counter_] = boost::bind (callback, boost::ref (instance), _1, custom_data);
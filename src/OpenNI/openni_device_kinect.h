@@ -78,7 +78,10 @@ protected:
 
 void DeviceKinect::setDebayeringMethod (const ImageBayerGRBG::DebayeringMethod& debayering_method) throw ()
 {
+  // pooled images were created with the old method
+  boost::lock_guard<boost::mutex> image_lock (image_mutex_);
   debayering_method_ = debayering_method;
+  image_pool_.clear ();
 }
 
 const ImageBayerGRBG::DebayeringMethod& DeviceKinect::getDebayeringMethod () const throw ()
@@ -0,0 +1,103 @@
+/*
+ * openni_frame_pool.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef OPENNI_FRAME_POOL_H_
+#define OPENNI_FRAME_POOL_H_
+
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace openni_wrapper
+{
+
+/**
+ * Metadata objects and the image objects wrapping them, kept by a device's
+ * data thread for one stream. A slot is free again once the pool holds
+ * the only reference to its wrapper, i.e. every callback has let go of the
+ * frame, so after the first few frames nothing is allocated per frame
+ */
+template <class MetaData, class Wrapper>
+class FramePool : boost::noncopyable
+{
+public:
+  struct Slot
+  {
+    boost::shared_ptr<MetaData> meta_data;
+    /** 0 until the data thread creates it for meta_data */
+    boost::shared_ptr<Wrapper> wrapper;
+  };
+
+  FramePool ()
+  : hits_ (0)
+  , misses_ (0)
+  {
+  }
+
+  /**
+   * A free slot for the next frame to be read into, or a new one with a
+   * fresh metadata object if all are still in use. Only the stream's data
+   * thread may call this
+   */
+  Slot& acquire ()
+  {
+    for (typename std::vector<Slot>::iterator slot = slots_.begin (); slot != slots_.end (); ++slot)
+    {
+      if (!slot->wrapper || slot->wrapper.unique ())
+      {
+        ++hits_;
+        return *slot;
+      }
+    }
+
+    ++misses_;
+    slots_.push_back (Slot ());
+    slots_.back ().meta_data.reset (new MetaData);
+    return slots_.back ();
+  }
+
+  /**
+   * Drops all slots, frames still referenced elsewhere are freed as usual
+   */
+  void clear ()
+  {
+    slots_.clear ();
+  }
+
+  /**
+   * Like clear () but also forgets the counters, for a stream that turns
+   * out not to use the pool at all
+   */
+  void reset ()
+  {
+    slots_.clear ();
+    hits_ = 0;
+    misses_ = 0;
+  }
+
+  /** frames that reused a slot */
+  unsigned long getHits () const
+  {
+    return hits_;
+  }
+
+  /** frames that had to allocate a new slot */
+  unsigned long getMisses () const
+  {
+    return misses_;
+  }
+
+private:
+  std::vector<Slot> slots_;
+  boost::atomic<unsigned long> hits_;
+  boost::atomic<unsigned long> misses_;
+};
+
+} // namespace openni_wrapper
+
+#endif /* OPENNI_FRAME_POOL_H_ */
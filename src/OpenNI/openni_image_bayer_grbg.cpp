@@ -35,8 +35,12 @@
  *
  */
 #include "openni_image_bayer_grbg.h"
+#include "openni_simd.h"
+#include "openni_row_band_pool.h"
 #include <sstream>
+#include <algorithm>
 #include <iostream>
+#include <boost/bind.hpp>
 
 #define AVG(a,b) (((int)(a) + (int)(b)) >> 1)
 #define AVG3(a,b,c) (((int)(a) + (int)(b) + (int)(c)) / 3)
@@ -75,6 +79,7 @@ void ImageBayerGRBG::fillGrayscale (unsigned width, unsigned height, unsigned ch
   if (image_md_->XRes () == width && image_md_->YRes () == height)
   { // if no downsampling
     const XnUInt8 *bayer_pixel = image_md_->Data ();
+    unsigned char* gray_image = gray_buffer;
     int line_skip = image_md_->XRes ();
     if (debayering_method_ == Bilinear)
     {
@@ -89,31 +94,10 @@ void ImageBayerGRBG::fillGrayscale (unsigned width, unsigned height, unsigned ch
       gray_buffer += 2 + gray_line_skip;
       bayer_pixel += 2;
 
-      for (register unsigned yIdx = 1; yIdx < height - 1; yIdx += 2)
-      {
-        // blue line
-        gray_buffer[0] = AVG3 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[1]);
-        gray_buffer[1] = bayer_pixel[1];
-        gray_buffer += 2;
-        bayer_pixel += 2;
-        for (register unsigned xIdx = 2; xIdx < width; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
-        {
-          gray_buffer[0] = AVG4 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[-1], bayer_pixel[1]);
-          gray_buffer[1] = bayer_pixel[1];
-        }
-        gray_buffer += gray_line_skip;
-
-        // red line
-        for (register unsigned xIdx = 0; xIdx < width - 2; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
-        {
-          gray_buffer[0] = bayer_pixel[0]; // green pixel
-          gray_buffer[1] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[-line_skip + 1], bayer_pixel[line_skip + 1]); // interpolated green pixel
-        }
-        gray_buffer[0] = bayer_pixel[0];
-        gray_buffer[1] = AVG3 (bayer_pixel[-line_skip + 1], bayer_pixel[line_skip + 1], bayer_pixel[-1]);
-        gray_buffer += 2 + gray_line_skip;
-        bayer_pixel += 2;
-      }
+      // remaining pairs of lines, split into row bands
+      RowBandPool::run (1, height - 1, 2, boost::bind (&ImageBayerGRBG::fillGrayscaleRows, this, width, gray_image, gray_line_step, _1, _2));
+      bayer_pixel = image_md_->Data () + (height - 1) * line_skip;
+      gray_buffer = gray_image + (height - 1) * gray_line_step;
 
       // last line BGBGBG
       gray_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-line_skip]);
@@ -128,7 +112,6 @@ void ImageBayerGRBG::fillGrayscale (unsigned width, unsigned height, unsigned ch
     }
     else if (debayering_method_ == EdgeAware)
     {
-      int dv, dh;
       // first line GRGRGR
       for (register unsigned xIdx = 0; xIdx < width - 2; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
       {
@@ -140,47 +123,10 @@ void ImageBayerGRBG::fillGrayscale (unsigned width, unsigned height, unsigned ch
       gray_buffer += 2 + gray_line_skip;
       bayer_pixel += 2;
 
-      for (register unsigned yIdx = 1; yIdx < height - 1; yIdx += 2)
-      {
-        // blue line
-        gray_buffer[0] = AVG3 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[1]);
-        gray_buffer[1] = bayer_pixel[1];
-        gray_buffer += 2;
-        bayer_pixel += 2;
-        for (register unsigned xIdx = 2; xIdx < width; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
-        {
-          dv = abs (bayer_pixel[-line_skip] - bayer_pixel[line_skip]);
-          dh = abs (bayer_pixel[-1] - bayer_pixel[1]);
-          if (dh > dv)
-            gray_buffer[0] = AVG (bayer_pixel[-line_skip], bayer_pixel[line_skip]);
-          else if (dv > dh)
-            gray_buffer[0] = AVG (bayer_pixel[-1], bayer_pixel[1]);
-          else
-            gray_buffer[0] = AVG4 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[-1], bayer_pixel[1]);
-
-          gray_buffer[1] = bayer_pixel[1];
-        }
-        gray_buffer += gray_line_skip;
-
-        // red line
-        for (register unsigned xIdx = 0; xIdx < width - 2; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
-        {
-          gray_buffer[0] = bayer_pixel[0];
-
-          dv = abs (bayer_pixel[1 - line_skip] - bayer_pixel[1 + line_skip]);
-          dh = abs (bayer_pixel[0] - bayer_pixel[2]);
-          if (dh > dv)
-            gray_buffer[1] = AVG (bayer_pixel[1 - line_skip], bayer_pixel[1 + line_skip]);
-          else if (dv > dh)
-            gray_buffer[1] = AVG (bayer_pixel[0], bayer_pixel[2]);
-          else
-            gray_buffer[1] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[-line_skip + 1], bayer_pixel[line_skip + 1]);
-        }
-        gray_buffer[0] = bayer_pixel[0];
-        gray_buffer[1] = AVG3 (bayer_pixel[-line_skip + 1], bayer_pixel[line_skip + 1], bayer_pixel[-1]);
-        gray_buffer += 2 + gray_line_skip;
-        bayer_pixel += 2;
-      }
+      // remaining pairs of lines, split into row bands
+      RowBandPool::run (1, height - 1, 2, boost::bind (&ImageBayerGRBG::fillGrayscaleRows, this, width, gray_image, gray_line_step, _1, _2));
+      bayer_pixel = image_md_->Data () + (height - 1) * line_skip;
+      gray_buffer = gray_image + (height - 1) * gray_line_step;
 
       // last line BGBGBG
       gray_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-line_skip]);
@@ -195,7 +141,6 @@ void ImageBayerGRBG::fillGrayscale (unsigned width, unsigned height, unsigned ch
     }
     else if (debayering_method_ == EdgeAwareWeighted)
     {
-      int dv, dh;
       // first line GRGRGR
       for (register unsigned xIdx = 0; xIdx < width - 2; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
       {
@@ -207,46 +152,10 @@ void ImageBayerGRBG::fillGrayscale (unsigned width, unsigned height, unsigned ch
       gray_buffer += 2 + gray_line_skip;
       bayer_pixel += 2;
 
-      for (register unsigned yIdx = 1; yIdx < height - 1; yIdx += 2)
-      {
-        // blue line
-        gray_buffer[0] = AVG3 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[1]);
-        gray_buffer[1] = bayer_pixel[1];
-        gray_buffer += 2;
-        bayer_pixel += 2;
-        for (register unsigned xIdx = 2; xIdx < width; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
-        {
-          dv = abs (bayer_pixel[-line_skip] - bayer_pixel[line_skip]);
-          dh = abs (bayer_pixel[-1] - bayer_pixel[1]);
-
-          if (dv == 0 && dh == 0)
-            gray_buffer[0] = AVG4 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[-1], bayer_pixel[1]);
-          else
-            gray_buffer[0] = WAVG4 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[-1], bayer_pixel[1], dh, dv);
-
-          gray_buffer[1] = bayer_pixel[1];
-        }
-
-        gray_buffer += gray_line_skip;
-
-        // red line
-        for (register unsigned xIdx = 0; xIdx < width - 2; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
-        {
-          gray_buffer[0] = bayer_pixel[0];
-
-          dv = abs (bayer_pixel[1 - line_skip] - bayer_pixel[1 + line_skip]);
-          dh = abs (bayer_pixel[0] - bayer_pixel[2]);
-
-          if (dv == 0 && dh == 0)
-            gray_buffer[1] = AVG4 (bayer_pixel[1 - line_skip], bayer_pixel[1 + line_skip], bayer_pixel[0], bayer_pixel[2]);
-          else
-            gray_buffer[1] = WAVG4 (bayer_pixel[1 - line_skip], bayer_pixel[1 + line_skip], bayer_pixel[0], bayer_pixel[2], dh, dv);
-        }
-        gray_buffer[0] = bayer_pixel[0];
-        gray_buffer[1] = AVG3 (bayer_pixel[-line_skip + 1], bayer_pixel[line_skip + 1], bayer_pixel[-1]);
-        gray_buffer += 2 + gray_line_skip;
-        bayer_pixel += 2;
-      }
+      // remaining pairs of lines, split into row bands
+      RowBandPool::run (1, height - 1, 2, boost::bind (&ImageBayerGRBG::fillGrayscaleRows, this, width, gray_image, gray_line_step, _1, _2));
+      bayer_pixel = image_md_->Data () + (height - 1) * line_skip;
+      gray_buffer = gray_image + (height - 1) * gray_line_step;
 
       // last line BGBGBG
       gray_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-line_skip]);
@@ -285,6 +194,133 @@ void ImageBayerGRBG::fillGrayscale (unsigned width, unsigned height, unsigned ch
   } // downsampling
 }
 
+void ImageBayerGRBG::fillGrayscaleRows (unsigned width, unsigned char* gray_image, unsigned gray_line_step, unsigned first_row, unsigned last_row) const
+{
+  // pairs of a blue and a red line, starting at the blue one
+  const XnUInt8 *bayer_pixel = image_md_->Data () + first_row * image_md_->XRes ();
+  unsigned char* gray_buffer = gray_image + first_row * gray_line_step;
+  unsigned gray_line_skip = gray_line_step - width;
+  int line_skip = image_md_->XRes ();
+
+  if (debayering_method_ == Bilinear)
+  {
+    for (register unsigned yIdx = first_row; yIdx < last_row; yIdx += 2)
+    {
+      // blue line
+      gray_buffer[0] = AVG3 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[1]);
+      gray_buffer[1] = bayer_pixel[1];
+      gray_buffer += 2;
+      bayer_pixel += 2;
+      for (register unsigned xIdx = 2; xIdx < width; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
+      {
+        gray_buffer[0] = AVG4 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[-1], bayer_pixel[1]);
+        gray_buffer[1] = bayer_pixel[1];
+      }
+      gray_buffer += gray_line_skip;
+
+      // red line
+      for (register unsigned xIdx = 0; xIdx < width - 2; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
+      {
+        gray_buffer[0] = bayer_pixel[0]; // green pixel
+        gray_buffer[1] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[-line_skip + 1], bayer_pixel[line_skip + 1]); // interpolated green pixel
+      }
+      gray_buffer[0] = bayer_pixel[0];
+      gray_buffer[1] = AVG3 (bayer_pixel[-line_skip + 1], bayer_pixel[line_skip + 1], bayer_pixel[-1]);
+      gray_buffer += 2 + gray_line_skip;
+      bayer_pixel += 2;
+    }
+  }
+  else if (debayering_method_ == EdgeAware)
+  {
+    int dv, dh;
+    for (register unsigned yIdx = first_row; yIdx < last_row; yIdx += 2)
+    {
+      // blue line
+      gray_buffer[0] = AVG3 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[1]);
+      gray_buffer[1] = bayer_pixel[1];
+      gray_buffer += 2;
+      bayer_pixel += 2;
+      for (register unsigned xIdx = 2; xIdx < width; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
+      {
+        dv = abs (bayer_pixel[-line_skip] - bayer_pixel[line_skip]);
+        dh = abs (bayer_pixel[-1] - bayer_pixel[1]);
+        if (dh > dv)
+          gray_buffer[0] = AVG (bayer_pixel[-line_skip], bayer_pixel[line_skip]);
+        else if (dv > dh)
+          gray_buffer[0] = AVG (bayer_pixel[-1], bayer_pixel[1]);
+        else
+          gray_buffer[0] = AVG4 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[-1], bayer_pixel[1]);
+
+        gray_buffer[1] = bayer_pixel[1];
+      }
+      gray_buffer += gray_line_skip;
+
+      // red line
+      for (register unsigned xIdx = 0; xIdx < width - 2; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
+      {
+        gray_buffer[0] = bayer_pixel[0];
+
+        dv = abs (bayer_pixel[1 - line_skip] - bayer_pixel[1 + line_skip]);
+        dh = abs (bayer_pixel[0] - bayer_pixel[2]);
+        if (dh > dv)
+          gray_buffer[1] = AVG (bayer_pixel[1 - line_skip], bayer_pixel[1 + line_skip]);
+        else if (dv > dh)
+          gray_buffer[1] = AVG (bayer_pixel[0], bayer_pixel[2]);
+        else
+          gray_buffer[1] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[-line_skip + 1], bayer_pixel[line_skip + 1]);
+      }
+      gray_buffer[0] = bayer_pixel[0];
+      gray_buffer[1] = AVG3 (bayer_pixel[-line_skip + 1], bayer_pixel[line_skip + 1], bayer_pixel[-1]);
+      gray_buffer += 2 + gray_line_skip;
+      bayer_pixel += 2;
+    }
+  }
+  else if (debayering_method_ == EdgeAwareWeighted)
+  {
+    int dv, dh;
+    for (register unsigned yIdx = first_row; yIdx < last_row; yIdx += 2)
+    {
+      // blue line
+      gray_buffer[0] = AVG3 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[1]);
+      gray_buffer[1] = bayer_pixel[1];
+      gray_buffer += 2;
+      bayer_pixel += 2;
+      for (register unsigned xIdx = 2; xIdx < width; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
+      {
+        dv = abs (bayer_pixel[-line_skip] - bayer_pixel[line_skip]);
+        dh = abs (bayer_pixel[-1] - bayer_pixel[1]);
+
+        if (dv == 0 && dh == 0)
+          gray_buffer[0] = AVG4 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[-1], bayer_pixel[1]);
+        else
+          gray_buffer[0] = WAVG4 (bayer_pixel[-line_skip], bayer_pixel[line_skip], bayer_pixel[-1], bayer_pixel[1], dh, dv);
+
+        gray_buffer[1] = bayer_pixel[1];
+      }
+
+      gray_buffer += gray_line_skip;
+
+      // red line
+      for (register unsigned xIdx = 0; xIdx < width - 2; xIdx += 2, gray_buffer += 2, bayer_pixel += 2)
+      {
+        gray_buffer[0] = bayer_pixel[0];
+
+        dv = abs (bayer_pixel[1 - line_skip] - bayer_pixel[1 + line_skip]);
+        dh = abs (bayer_pixel[0] - bayer_pixel[2]);
+
+        if (dv == 0 && dh == 0)
+          gray_buffer[1] = AVG4 (bayer_pixel[1 - line_skip], bayer_pixel[1 + line_skip], bayer_pixel[0], bayer_pixel[2]);
+        else
+          gray_buffer[1] = WAVG4 (bayer_pixel[1 - line_skip], bayer_pixel[1 + line_skip], bayer_pixel[0], bayer_pixel[2], dh, dv);
+      }
+      gray_buffer[0] = bayer_pixel[0];
+      gray_buffer[1] = AVG3 (bayer_pixel[-line_skip + 1], bayer_pixel[line_skip + 1], bayer_pixel[-1]);
+      gray_buffer += 2 + gray_line_skip;
+      bayer_pixel += 2;
+    }
+  }
+}
+
 void ImageBayerGRBG::fillRGB (unsigned width, unsigned height, unsigned char* rgb_buffer, unsigned rgb_line_step) const throw (OpenNIException)
 {
   if (width > image_md_->XRes () || height > image_md_->YRes ())
@@ -298,385 +334,807 @@ void ImageBayerGRBG::fillRGB (unsigned width, unsigned height, unsigned char* rg
 
   if (image_md_->XRes () == width && image_md_->YRes () == height)
   {
-    register const XnUInt8 *bayer_pixel = image_md_->Data ();
-    register unsigned yIdx, xIdx;
+    if (debayering_method_ != Bilinear && debayering_method_ != EdgeAware && debayering_method_ != EdgeAwareWeighted)
+      THROW_OPENNI_EXCEPTION ("Unknwon debayering method: %d", (int)debayering_method_);
+
+    fillRGBFirstLines (width, rgb_buffer, rgb_line_step);
+
+    // main processing, split into row bands
+    RowBandPool::run (2, height - 2, 2, boost::bind (&ImageBayerGRBG::fillRGBRows, this, width, rgb_buffer, rgb_line_step, _1, _2));
+
+    fillRGBLastLines (width, height, rgb_buffer + (height - 2) * rgb_line_step, rgb_line_step);
+  }
+  else
+  {
+    if (image_md_->XRes () % width != 0 || image_md_->YRes () % height != 0)
+      THROW_OPENNI_EXCEPTION ("Downsampling only possible for integer scales in both dimensions. Request was %d x %d -> %d x %d.", image_md_->XRes (), image_md_->YRes (), width, height);
+
+    // get each or each 2nd pixel group to find rgb values!
+    register unsigned bayerXStep = image_md_->XRes () / width;
+    register unsigned bayerYSkip = (image_md_->YRes () / height - 1) * image_md_->XRes ();
 
-    int bayer_line_step = image_md_->XRes ();
-    int bayer_line_step2 = image_md_->XRes () << 1;
+    // Downsampling and debayering at once
+    register const XnUInt8* bayer_buffer = image_md_->Data ();
 
-    if (debayering_method_ == Bilinear)
+    for (register unsigned yIdx = 0; yIdx < height; ++yIdx, bayer_buffer += bayerYSkip, rgb_buffer += rgb_line_skip) // skip a line
     {
-      // first two pixel values for first two lines
-      // Bayer         0 1 2
-      //         0     G r g
-      // line_step     b g b
-      // line_step2    g r g
+      for (register unsigned xIdx = 0; xIdx < width; ++xIdx, rgb_buffer += 3, bayer_buffer += bayerXStep)
+      {
+        rgb_buffer[ 2 ] = bayer_buffer[ image_md_->XRes () ];
+        rgb_buffer[ 1 ] = AVG (bayer_buffer[0], bayer_buffer[ image_md_->XRes () + 1]);
+        rgb_buffer[ 0 ] = bayer_buffer[ 1 ];
+      }
+    }
+  }
+}
 
-      rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
-      rgb_buffer[1] = bayer_pixel[0]; // green pixel
-      rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
+void ImageBayerGRBG::fillRGBBand (unsigned first_row, unsigned last_row, unsigned char* rgb_buffer, unsigned rgb_line_step) const throw (OpenNIException)
+{
+  unsigned width = image_md_->XRes ();
+  unsigned height = image_md_->YRes ();
 
-      // Bayer         0 1 2
-      //         0     g R g
-      // line_step     b g b
-      // line_step2    g r g
-      //rgb_pixel[3] = bayer_pixel[1];
-      rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
-      rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+  if (first_row % 2 != 0 || last_row % 2 != 0 || first_row >= last_row || last_row > height)
+    THROW_OPENNI_EXCEPTION ("Bands have to start and end on even rows inside the image. Request was rows %d to %d of %d.", first_row, last_row, height);
 
-      // BGBG line
-      // Bayer         0 1 2
-      //         0     g r g
-      // line_step     B g b
-      // line_step2    g r g
-      rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-      rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
-      //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
+  if (debayering_method_ != Bilinear && debayering_method_ != EdgeAware && debayering_method_ != EdgeAwareWeighted)
+    THROW_OPENNI_EXCEPTION ("Unknwon debayering method: %d", (int)debayering_method_);
 
-      // pixel (1, 1)  0 1 2
-      //         0     g r g
-      // line_step     b G b
-      // line_step2    g r g
-      //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
-      rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-      //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
+  if (rgb_line_step == 0)
+    rgb_line_step = width * 3;
 
-      rgb_buffer += 6;
-      bayer_pixel += 2;
-      // rest of the first two lines
+  unsigned row = first_row;
+  if (row == 0)
+  {
+    fillRGBFirstLines (width, rgb_buffer, rgb_line_step);
+    row = 2;
+  }
 
-      for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
-      {
-        // GRGR line
-        // Bayer        -1 0 1 2
-        //           0   r G r g
-        //   line_step   g b g b
-        // line_step2    r g r g
-        rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-        rgb_buffer[1] = bayer_pixel[0];
-        rgb_buffer[2] = bayer_pixel[bayer_line_step + 1];
+  unsigned main_end = min (last_row, height - 2);
+  if (row < main_end)
+    fillRGBLines (width, rgb_buffer + (row - first_row) * rgb_line_step, rgb_line_step, row, main_end);
 
-        // Bayer        -1 0 1 2
-        //          0    r g R g
-        //  line_step    g b g b
-        // line_step2    r g r g
-        rgb_buffer[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
-        rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+  if (last_row == height)
+    fillRGBLastLines (width, height, rgb_buffer + (height - 2 - first_row) * rgb_line_step, rgb_line_step);
+}
 
-        // BGBG line
-        // Bayer         -1 0 1 2
-        //         0      r g r g
-        // line_step      g B g b
-        // line_step2     r g r g
-        rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-        rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-        rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+void ImageBayerGRBG::fillRGBFirstLines (unsigned width, unsigned char* rgb_buffer, unsigned rgb_line_step) const
+{
+  register const XnUInt8 *bayer_pixel = image_md_->Data ();
+  register unsigned xIdx;
 
-        // Bayer         -1 0 1 2
-        //         0      r g r g
-        // line_step      g b G b
-        // line_step2     r g r g
-        rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-        rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-        //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
-      }
+  int bayer_line_step = image_md_->XRes ();
+  int bayer_line_step2 = image_md_->XRes () << 1;
 
-      // last two pixel values for first two lines
+  if (debayering_method_ == Bilinear)
+  {
+    // first two pixel values for first two lines
+    // Bayer         0 1 2
+    //         0     G r g
+    // line_step     b g b
+    // line_step2    g r g
+
+    rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
+    rgb_buffer[1] = bayer_pixel[0]; // green pixel
+    rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
+
+    // Bayer         0 1 2
+    //         0     g R g
+    // line_step     b g b
+    // line_step2    g r g
+    //rgb_pixel[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
+    rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+
+    // BGBG line
+    // Bayer         0 1 2
+    //         0     g r g
+    // line_step     B g b
+    // line_step2    g r g
+    rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
+    rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
+    //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
+
+    // pixel (1, 1)  0 1 2
+    //         0     g r g
+    // line_step     b G b
+    // line_step2    g r g
+    //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
+
+    rgb_buffer += 6;
+    bayer_pixel += 2;
+    // rest of the first two lines
+
+    for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
+    {
       // GRGR line
-      // Bayer        -1 0 1
-      //           0   r G r
-      //   line_step   g b g
-      // line_step2    r g r
+      // Bayer        -1 0 1 2
+      //           0   r G r g
+      //   line_step   g b g b
+      // line_step2    r g r g
       rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
       rgb_buffer[1] = bayer_pixel[0];
-      rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = rgb_buffer[5] = rgb_buffer[2] = bayer_pixel[bayer_line_step];
+      rgb_buffer[2] = bayer_pixel[bayer_line_step + 1];
 
-      // Bayer        -1 0 1
-      //          0    r g R
-      //  line_step    g b g
-      // line_step2    r g r
+      // Bayer        -1 0 1 2
+      //          0    r g R g
+      //  line_step    g b g b
+      // line_step2    r g r g
       rgb_buffer[3] = bayer_pixel[1];
-      rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
-      //rgb_pixel[5] = bayer_pixel[line_step];
+      rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
+      rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
 
       // BGBG line
-      // Bayer        -1 0 1
-      //          0    r g r
-      //  line_step    g B g
-      // line_step2    r g r
+      // Bayer         -1 0 1 2
+      //         0      r g r g
+      // line_step      g B g b
+      // line_step2     r g r g
       rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
       rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-      //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
+      rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
 
-      // Bayer         -1 0 1
-      //         0      r g r
-      // line_step      g b G
-      // line_step2     r g r
+      // Bayer         -1 0 1 2
+      //         0      r g r g
+      // line_step      g b G b
+      // line_step2     r g r g
       rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
       rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-      //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
+      //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
+    }
 
-      bayer_pixel += bayer_line_step + 2;
-      rgb_buffer += rgb_line_step + 6 + rgb_line_skip;
+    // last two pixel values for first two lines
+    // GRGR line
+    // Bayer        -1 0 1
+    //           0   r G r
+    //   line_step   g b g
+    // line_step2    r g r
+    rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+    rgb_buffer[1] = bayer_pixel[0];
+    rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = rgb_buffer[5] = rgb_buffer[2] = bayer_pixel[bayer_line_step];
+
+    // Bayer        -1 0 1
+    //          0    r g R
+    //  line_step    g b g
+    // line_step2    r g r
+    rgb_buffer[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
+    //rgb_pixel[5] = bayer_pixel[line_step];
+
+    // BGBG line
+    // Bayer        -1 0 1
+    //          0    r g r
+    //  line_step    g B g
+    // line_step2    r g r
+    rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
+    rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+    //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
+
+    // Bayer         -1 0 1
+    //         0      r g r
+    // line_step      g b G
+    // line_step2     r g r
+    rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
+  }
+  else if (debayering_method_ == EdgeAware)
+  {
+    // first two pixel values for first two lines
+    // Bayer         0 1 2
+    //         0     G r g
+    // line_step     b g b
+    // line_step2    g r g
+
+    rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
+    rgb_buffer[1] = bayer_pixel[0]; // green pixel
+    rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
+
+    // Bayer         0 1 2
+    //         0     g R g
+    // line_step     b g b
+    // line_step2    g r g
+    //rgb_pixel[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
+    rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+
+    // BGBG line
+    // Bayer         0 1 2
+    //         0     g r g
+    // line_step     B g b
+    // line_step2    g r g
+    rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
+    rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
+    //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
+
+    // pixel (1, 1)  0 1 2
+    //         0     g r g
+    // line_step     b G b
+    // line_step2    g r g
+    //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
+
+    rgb_buffer += 6;
+    bayer_pixel += 2;
+    // rest of the first two lines
+    for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
+    {
+      // GRGR line
+      // Bayer        -1 0 1 2
+      //           0   r G r g
+      //   line_step   g b g b
+      // line_step2    r g r g
+      rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+      rgb_buffer[1] = bayer_pixel[0];
+      rgb_buffer[2] = bayer_pixel[bayer_line_step + 1];
 
-      // main processing
+      // Bayer        -1 0 1 2
+      //          0    r g R g
+      //  line_step    g b g b
+      // line_step2    r g r g
+      rgb_buffer[3] = bayer_pixel[1];
+      rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
+      rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
 
-      for (yIdx = 2; yIdx < height - 2; yIdx += 2)
-      {
-        // first two pixel values
-        // Bayer         0 1 2
-        //        -1     b g b
-        //         0     G r g
-        // line_step     b g b
-        // line_step2    g r g
-
-        rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
-        rgb_buffer[1] = bayer_pixel[0]; // green pixel
-        rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]); // blue;
-
-        // Bayer         0 1 2
-        //        -1     b g b
-        //         0     g R g
-        // line_step     b g b
-        // line_step2    g r g
-        //rgb_pixel[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-        rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
+      // BGBG line
+      // Bayer         -1 0 1 2
+      //         0      r g r g
+      // line_step      g B g b
+      // line_step2     r g r g
+      rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
+      rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+      rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
 
-        // BGBG line
-        // Bayer         0 1 2
-        //         0     g r g
-        // line_step     B g b
-        // line_step2    g r g
-        rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-        rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
-        rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+      // Bayer         -1 0 1 2
+      //         0      r g r g
+      // line_step      g b G b
+      // line_step2     r g r g
+      rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
+      rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+      //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
+    }
 
-        // pixel (1, 1)  0 1 2
-        //         0     g r g
-        // line_step     b G b
-        // line_step2    g r g
-        //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
-        rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-        rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+    // last two pixel values for first two lines
+    // GRGR line
+    // Bayer        -1 0 1
+    //           0   r G r
+    //   line_step   g b g
+    // line_step2    r g r
+    rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+    rgb_buffer[1] = bayer_pixel[0];
+    rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = rgb_buffer[5] = rgb_buffer[2] = bayer_pixel[bayer_line_step];
+
+    // Bayer        -1 0 1
+    //          0    r g R
+    //  line_step    g b g
+    // line_step2    r g r
+    rgb_buffer[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
+    //rgb_pixel[5] = bayer_pixel[line_step];
+
+    // BGBG line
+    // Bayer        -1 0 1
+    //          0    r g r
+    //  line_step    g B g
+    // line_step2    r g r
+    rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
+    rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+    //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
+
+    // Bayer         -1 0 1
+    //         0      r g r
+    // line_step      g b G
+    // line_step2     r g r
+    rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
+  }
+  else if (debayering_method_ == EdgeAwareWeighted)
+  {
+    // first two pixel values for first two lines
+    // Bayer         0 1 2
+    //         0     G r g
+    // line_step     b g b
+    // line_step2    g r g
+
+    rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
+    rgb_buffer[1] = bayer_pixel[0]; // green pixel
+    rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
+
+    // Bayer         0 1 2
+    //         0     g R g
+    // line_step     b g b
+    // line_step2    g r g
+    //rgb_pixel[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
+    rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+
+    // BGBG line
+    // Bayer         0 1 2
+    //         0     g r g
+    // line_step     B g b
+    // line_step2    g r g
+    rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
+    rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
+    //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
+
+    // pixel (1, 1)  0 1 2
+    //         0     g r g
+    // line_step     b G b
+    // line_step2    g r g
+    //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
+
+    rgb_buffer += 6;
+    bayer_pixel += 2;
+    // rest of the first two lines
+    for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
+    {
+      // GRGR line
+      // Bayer        -1 0 1 2
+      //           0   r G r g
+      //   line_step   g b g b
+      // line_step2    r g r g
+      rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+      rgb_buffer[1] = bayer_pixel[0];
+      rgb_buffer[2] = bayer_pixel[bayer_line_step + 1];
 
-        rgb_buffer += 6;
-        bayer_pixel += 2;
-        // continue with rest of the line
-        for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
-        {
-          // GRGR line
-          // Bayer        -1 0 1 2
-          //          -1   g b g b
-          //           0   r G r g
-          //   line_step   g b g b
-          // line_step2    r g r g
-          rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-          rgb_buffer[1] = bayer_pixel[0];
-          rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
-
-          // Bayer        -1 0 1 2
-          //          -1   g b g b
-          //          0    r g R g
-          //  line_step    g b g b
-          // line_step2    r g r g
-          rgb_buffer[3] = bayer_pixel[1];
-          rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-          rgb_buffer[5] = AVG4 (bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step], bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-
-          // BGBG line
-          // Bayer         -1 0 1 2
-          //         -1     g b g b
-          //          0     r g r g
-          // line_step      g B g b
-          // line_step2     r g r g
-          rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-          rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-          rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-
-          // Bayer         -1 0 1 2
-          //         -1     g b g b
-          //          0     r g r g
-          // line_step      g b G b
-          // line_step2     r g r g
-          rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-          rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-          rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-        }
-
-        // last two pixels of the line
-        // last two pixel values for first two lines
-        // GRGR line
-        // Bayer        -1 0 1
-        //           0   r G r
-        //   line_step   g b g
-        // line_step2    r g r
-        rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-        rgb_buffer[1] = bayer_pixel[0];
-        rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = rgb_buffer[5] = rgb_buffer[2] = bayer_pixel[bayer_line_step];
+      // Bayer        -1 0 1 2
+      //          0    r g R g
+      //  line_step    g b g b
+      // line_step2    r g r g
+      rgb_buffer[3] = bayer_pixel[1];
+      rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
+      rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
 
-        // Bayer        -1 0 1
-        //          0    r g R
-        //  line_step    g b g
-        // line_step2    r g r
-        rgb_buffer[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
-        //rgb_pixel[5] = bayer_pixel[line_step];
+      // BGBG line
+      // Bayer         -1 0 1 2
+      //         0      r g r g
+      // line_step      g B g b
+      // line_step2     r g r g
+      rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
+      rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+      rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
 
-        // BGBG line
-        // Bayer        -1 0 1
-        //          0    r g r
-        //  line_step    g B g
-        // line_step2    r g r
-        rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-        rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-        //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
+      // Bayer         -1 0 1 2
+      //         0      r g r g
+      // line_step      g b G b
+      // line_step2     r g r g
+      rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
+      rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+      //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
+    }
 
-        // Bayer         -1 0 1
-        //         0      r g r
-        // line_step      g b G
-        // line_step2     r g r
-        rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-        rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-        //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
+    // last two pixel values for first two lines
+    // GRGR line
+    // Bayer        -1 0 1
+    //           0   r G r
+    //   line_step   g b g
+    // line_step2    r g r
+    rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+    rgb_buffer[1] = bayer_pixel[0];
+    rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = rgb_buffer[5] = rgb_buffer[2] = bayer_pixel[bayer_line_step];
+
+    // Bayer        -1 0 1
+    //          0    r g R
+    //  line_step    g b g
+    // line_step2    r g r
+    rgb_buffer[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
+    //rgb_pixel[5] = bayer_pixel[line_step];
+
+    // BGBG line
+    // Bayer        -1 0 1
+    //          0    r g r
+    //  line_step    g B g
+    // line_step2    r g r
+    rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
+    rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+    //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
+
+    // Bayer         -1 0 1
+    //         0      r g r
+    // line_step      g b G
+    // line_step2     r g r
+    rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
+  }
+}
 
-        bayer_pixel += bayer_line_step + 2;
-        rgb_buffer += rgb_line_step + 6 + rgb_line_skip;
-      }
+void ImageBayerGRBG::fillRGBLastLines (unsigned width, unsigned height, unsigned char* rgb_buffer, unsigned rgb_line_step) const
+{
+  // rgb_buffer points at the output of line height - 2
+  register const XnUInt8 *bayer_pixel = image_md_->Data () + (height - 2) * image_md_->XRes ();
+  register unsigned xIdx;
 
-      //last two lines
-      // Bayer         0 1 2
-      //        -1     b g b
-      //         0     G r g
-      // line_step     b g b
+  int bayer_line_step = image_md_->XRes ();
 
-      rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
-      rgb_buffer[1] = bayer_pixel[0]; // green pixel
-      rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
+  if (debayering_method_ == Bilinear)
+  {
+    //last two lines
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     G r g
+    // line_step     b g b
+
+    rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
+    rgb_buffer[1] = bayer_pixel[0]; // green pixel
+    rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
+
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     g R g
+    // line_step     b g b
+    //rgb_pixel[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
+    rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
+
+    // BGBG line
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     g r g
+    // line_step     B g b
+    //rgb_pixel[rgb_line_step    ] = bayer_pixel[1];
+    rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
+    rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     g r g
+    // line_step     b G b
+    //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+
+    rgb_buffer += 6;
+    bayer_pixel += 2;
+    // rest of the last two lines
+    for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
+    {
+      // GRGR line
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r G r g
+      // line_step    g b g b
+      rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+      rgb_buffer[1] = bayer_pixel[0];
+      rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
 
-      // Bayer         0 1 2
-      //        -1     b g b
-      //         0     g R g
-      // line_step     b g b
-      //rgb_pixel[3] = bayer_pixel[1];
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r g R g
+      // line_step    g b g b
+      rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
       rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-      rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
+      rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[-bayer_line_step + 2]);
 
       // BGBG line
-      // Bayer         0 1 2
-      //        -1     b g b
-      //         0     g r g
-      // line_step     B g b
-      //rgb_pixel[rgb_line_step    ] = bayer_pixel[1];
-      rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r g r g
+      // line_step    g B g b
+      rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[-1], bayer_pixel[1]);
+      rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
       rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
 
-      // Bayer         0 1 2
-      //        -1     b g b
-      //         0     g r g
-      // line_step     b G b
-      //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
+
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r g r g
+      // line_step    g b G b
+      //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
       rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
       rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+    }
 
-      rgb_buffer += 6;
-      bayer_pixel += 2;
-      // rest of the last two lines
-      for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
-      {
-        // GRGR line
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r G r g
-        // line_step    g b g b
-        rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-        rgb_buffer[1] = bayer_pixel[0];
-        rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
+    // last two pixel values for first two lines
+    // GRGR line
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r G r
+    // line_step    g b g
+    rgb_buffer[rgb_line_step ] = rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+    rgb_buffer[1] = bayer_pixel[0];
+    rgb_buffer[5] = rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
+
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r g R
+    // line_step    g b g
+    rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[-bayer_line_step + 1]);
+    //rgb_pixel[5] = AVG( bayer_pixel[line_step], bayer_pixel[-line_step] );
+
+    // BGBG line
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r g r
+    // line_step    g B g
+    //rgb_pixel[rgb_line_step    ] = AVG2( bayer_pixel[-1], bayer_pixel[1] );
+    rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+    rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r g r
+    // line_step    g b G
+    //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
+  }
+  else if (debayering_method_ == EdgeAware)
+  {
+    //last two lines
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     G r g
+    // line_step     b g b
+
+    rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
+    rgb_buffer[1] = bayer_pixel[0]; // green pixel
+    rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
+
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     g R g
+    // line_step     b g b
+    //rgb_pixel[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
+    rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
+
+    // BGBG line
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     g r g
+    // line_step     B g b
+    //rgb_pixel[rgb_line_step    ] = bayer_pixel[1];
+    rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
+    rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     g r g
+    // line_step     b G b
+    //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+
+    rgb_buffer += 6;
+    bayer_pixel += 2;
+    // rest of the last two lines
+    for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
+    {
+      // GRGR line
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r G r g
+      // line_step    g b g b
+      rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+      rgb_buffer[1] = bayer_pixel[0];
+      rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
 
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r g R g
-        // line_step    g b g b
-        rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-        rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[-bayer_line_step + 2]);
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r g R g
+      // line_step    g b g b
+      rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
+      rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
+      rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[-bayer_line_step + 2]);
 
-        // BGBG line
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r g r g
-        // line_step    g B g b
-        rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[-1], bayer_pixel[1]);
-        rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-        rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+      // BGBG line
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r g r g
+      // line_step    g B g b
+      rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[-1], bayer_pixel[1]);
+      rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+      rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
 
 
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r g r g
-        // line_step    g b G b
-        //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
-        rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-        rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-      }
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r g r g
+      // line_step    g b G b
+      //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
+      rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+      rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+    }
 
-      // last two pixel values for first two lines
+    // last two pixel values for first two lines
+    // GRGR line
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r G r
+    // line_step    g b g
+    rgb_buffer[rgb_line_step ] = rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+    rgb_buffer[1] = bayer_pixel[0];
+    rgb_buffer[5] = rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
+
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r g R
+    // line_step    g b g
+    rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[-bayer_line_step + 1]);
+    //rgb_pixel[5] = AVG( bayer_pixel[line_step], bayer_pixel[-line_step] );
+
+    // BGBG line
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r g r
+    // line_step    g B g
+    //rgb_pixel[rgb_line_step    ] = AVG2( bayer_pixel[-1], bayer_pixel[1] );
+    rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+    rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r g r
+    // line_step    g b G
+    //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
+  }
+  else if (debayering_method_ == EdgeAwareWeighted)
+  {
+    //last two lines
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     G r g
+    // line_step     b g b
+
+    rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
+    rgb_buffer[1] = bayer_pixel[0]; // green pixel
+    rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
+
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     g R g
+    // line_step     b g b
+    //rgb_pixel[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
+    rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
+
+    // BGBG line
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     g r g
+    // line_step     B g b
+    //rgb_pixel[rgb_line_step    ] = bayer_pixel[1];
+    rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
+    rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+
+    // Bayer         0 1 2
+    //        -1     b g b
+    //         0     g r g
+    // line_step     b G b
+    //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+
+    rgb_buffer += 6;
+    bayer_pixel += 2;
+    // rest of the last two lines
+    for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
+    {
       // GRGR line
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r G r
-      // line_step    g b g
-      rgb_buffer[rgb_line_step ] = rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r G r g
+      // line_step    g b g b
+      rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
       rgb_buffer[1] = bayer_pixel[0];
-      rgb_buffer[5] = rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
+      rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
+
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r g R g
+      // line_step    g b g b
+      rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
+      rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
+      rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[-bayer_line_step + 2]);
+
+      // BGBG line
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r g r g
+      // line_step    g B g b
+      rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[-1], bayer_pixel[1]);
+      rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+      rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+
+
+      // Bayer       -1 0 1 2
+      //        -1    g b g b
+      //         0    r g r g
+      // line_step    g b G b
+      //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
+      rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+      rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+    }
+
+    // last two pixel values for first two lines
+    // GRGR line
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r G r
+    // line_step    g b g
+    rgb_buffer[rgb_line_step ] = rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+    rgb_buffer[1] = bayer_pixel[0];
+    rgb_buffer[5] = rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
+
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r g R
+    // line_step    g b g
+    rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
+    rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[-bayer_line_step + 1]);
+    //rgb_pixel[5] = AVG( bayer_pixel[line_step], bayer_pixel[-line_step] );
+
+    // BGBG line
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r g r
+    // line_step    g B g
+    //rgb_pixel[rgb_line_step    ] = AVG2( bayer_pixel[-1], bayer_pixel[1] );
+    rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+    rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+
+    // Bayer       -1 0 1
+    //        -1    g b g
+    //         0    r g r
+    // line_step    g b G
+    //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
+    rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
+    //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
+  }
+}
+
+void ImageBayerGRBG::fillRGBRows (unsigned width, unsigned char* rgb_image, unsigned rgb_line_step, unsigned first_row, unsigned last_row) const
+{
+  fillRGBLines (width, rgb_image + first_row * rgb_line_step, rgb_line_step, first_row, last_row);
+}
 
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r g R
-      // line_step    g b g
-      rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
-      rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[-bayer_line_step + 1]);
-      //rgb_pixel[5] = AVG( bayer_pixel[line_step], bayer_pixel[-line_step] );
+void ImageBayerGRBG::fillRGBLines (unsigned width, unsigned char* rgb_buffer, unsigned rgb_line_step, unsigned first_row, unsigned last_row) const
+{
+  // pairs of a GRGR and a BGBG line, starting at the GRGR one
+  register const XnUInt8 *bayer_pixel = image_md_->Data () + first_row * image_md_->XRes ();
+  unsigned rgb_line_skip = rgb_line_step - width * 3;
+  register unsigned yIdx, xIdx;
 
-      // BGBG line
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r g r
-      // line_step    g B g
-      //rgb_pixel[rgb_line_step    ] = AVG2( bayer_pixel[-1], bayer_pixel[1] );
-      rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-      rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+  int bayer_line_step = image_md_->XRes ();
+  int bayer_line_step2 = image_md_->XRes () << 1;
 
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r g r
-      // line_step    g b G
-      //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
-      rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-      //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
-    }
-    else if (debayering_method_ == EdgeAware)
-    {
-      int dh, dv;
+  // SIMD kernel for the interior of each pair of lines, 0 if unavailable
+  const simd::Kernels* kernels = simd::getKernels ();
+  simd::DebayerRowKernel row_kernel = kernels && debayering_method_ <= EdgeAwareWeighted ? kernels->debayer[debayering_method_] : 0;
 
-      // first two pixel values for first two lines
+  if (debayering_method_ == Bilinear)
+  {
+    for (yIdx = first_row; yIdx < last_row; yIdx += 2)
+    {
+      // first two pixel values
       // Bayer         0 1 2
+      //        -1     b g b
       //         0     G r g
       // line_step     b g b
       // line_step2    g r g
 
       rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
       rgb_buffer[1] = bayer_pixel[0]; // green pixel
-      rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
+      rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]); // blue;
 
       // Bayer         0 1 2
+      //        -1     b g b
       //         0     g R g
       // line_step     b g b
       // line_step2    g r g
       //rgb_pixel[3] = bayer_pixel[1];
-      rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
-      rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+      rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
+      rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
 
       // BGBG line
       // Bayer         0 1 2
@@ -685,7 +1143,7 @@ void ImageBayerGRBG::fillRGB (unsigned width, unsigned height, unsigned char* rg
       // line_step2    g r g
       rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
       rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
-      //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
+      rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
 
       // pixel (1, 1)  0 1 2
       //         0     g r g
@@ -693,33 +1151,45 @@ void ImageBayerGRBG::fillRGB (unsigned width, unsigned height, unsigned char* rg
       // line_step2    g r g
       //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
       rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-      //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
+      rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
 
       rgb_buffer += 6;
       bayer_pixel += 2;
-      // rest of the first two lines
-      for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
+      // continue with rest of the line, vectorised as far as possible
+      xIdx = 2;
+      if (row_kernel)
+      {
+        unsigned simd_pixels = row_kernel (bayer_pixel, bayer_line_step, rgb_buffer, rgb_line_step, width - 4);
+        xIdx += simd_pixels;
+        bayer_pixel += simd_pixels;
+        rgb_buffer += simd_pixels * 3;
+      }
+
+      for (; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
       {
         // GRGR line
         // Bayer        -1 0 1 2
+        //          -1   g b g b
         //           0   r G r g
         //   line_step   g b g b
         // line_step2    r g r g
         rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
         rgb_buffer[1] = bayer_pixel[0];
-        rgb_buffer[2] = bayer_pixel[bayer_line_step + 1];
+        rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
 
         // Bayer        -1 0 1 2
+        //          -1   g b g b
         //          0    r g R g
         //  line_step    g b g b
         // line_step2    r g r g
         rgb_buffer[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
-        rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+        rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
+        rgb_buffer[5] = AVG4 (bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step], bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
 
         // BGBG line
         // Bayer         -1 0 1 2
-        //         0      r g r g
+        //         -1     g b g b
+        //          0     r g r g
         // line_step      g B g b
         // line_step2     r g r g
         rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
@@ -727,14 +1197,16 @@ void ImageBayerGRBG::fillRGB (unsigned width, unsigned height, unsigned char* rg
         rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
 
         // Bayer         -1 0 1 2
-        //         0      r g r g
+        //         -1     g b g b
+        //          0     r g r g
         // line_step      g b G b
         // line_step2     r g r g
         rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
         rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-        //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
+        rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
       }
 
+      // last two pixels of the line
       // last two pixel values for first two lines
       // GRGR line
       // Bayer        -1 0 1
@@ -772,281 +1244,32 @@ void ImageBayerGRBG::fillRGB (unsigned width, unsigned height, unsigned char* rg
 
       bayer_pixel += bayer_line_step + 2;
       rgb_buffer += rgb_line_step + 6 + rgb_line_skip;
-      // main processing
-      for (yIdx = 2; yIdx < height - 2; yIdx += 2)
-      {
-        // first two pixel values
-        // Bayer         0 1 2
-        //        -1     b g b
-        //         0     G r g
-        // line_step     b g b
-        // line_step2    g r g
-
-        rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
-        rgb_buffer[1] = bayer_pixel[0]; // green pixel
-        rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]); // blue;
-
-        // Bayer         0 1 2
-        //        -1     b g b
-        //         0     g R g
-        // line_step     b g b
-        // line_step2    g r g
-        //rgb_pixel[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-        rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
-
-        // BGBG line
-        // Bayer         0 1 2
-        //         0     g r g
-        // line_step     B g b
-        // line_step2    g r g
-        rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-        rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
-        rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-
-        // pixel (1, 1)  0 1 2
-        //         0     g r g
-        // line_step     b G b
-        // line_step2    g r g
-        //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
-        rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-        rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-
-        rgb_buffer += 6;
-        bayer_pixel += 2;
-        // continue with rest of the line
-        for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
-        {
-          // GRGR line
-          // Bayer        -1 0 1 2
-          //          -1   g b g b
-          //           0   r G r g
-          //   line_step   g b g b
-          // line_step2    r g r g
-          rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-          rgb_buffer[1] = bayer_pixel[0];
-          rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
-
-          // Bayer        -1 0 1 2
-          //          -1   g b g b
-          //          0    r g R g
-          //  line_step    g b g b
-          // line_step2    r g r g
-
-          dh = abs (bayer_pixel[0] - bayer_pixel[2]);
-          dv = abs (bayer_pixel[-bayer_line_step + 1] - bayer_pixel[bayer_line_step + 1]);
-
-          if (dh > dv)
-            rgb_buffer[4] = AVG (bayer_pixel[-bayer_line_step + 1], bayer_pixel[bayer_line_step + 1]);
-          else if (dv > dh)
-            rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[2]);
-          else
-            rgb_buffer[4] = AVG4 (bayer_pixel[-bayer_line_step + 1], bayer_pixel[bayer_line_step + 1], bayer_pixel[0], bayer_pixel[2]);
-
-          rgb_buffer[3] = bayer_pixel[1];
-          rgb_buffer[5] = AVG4 (bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step], bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-
-          // BGBG line
-          // Bayer         -1 0 1 2
-          //         -1     g b g b
-          //          0     r g r g
-          // line_step      g B g b
-          // line_step2     r g r g
-          rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-          rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-
-          dv = abs (bayer_pixel[0] - bayer_pixel[bayer_line_step2]);
-          dh = abs (bayer_pixel[bayer_line_step - 1] - bayer_pixel[bayer_line_step + 1]);
-
-          if (dv > dh)
-            rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-          else if (dh > dv)
-            rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step2]);
-          else
-            rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-
-          // Bayer         -1 0 1 2
-          //         -1     g b g b
-          //          0     r g r g
-          // line_step      g b G b
-          // line_step2     r g r g
-          rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-          rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-          rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-        }
-
-        // last two pixels of the line
-        // last two pixel values for first two lines
-        // GRGR line
-        // Bayer        -1 0 1
-        //           0   r G r
-        //   line_step   g b g
-        // line_step2    r g r
-        rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-        rgb_buffer[1] = bayer_pixel[0];
-        rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = rgb_buffer[5] = rgb_buffer[2] = bayer_pixel[bayer_line_step];
-
-        // Bayer        -1 0 1
-        //          0    r g R
-        //  line_step    g b g
-        // line_step2    r g r
-        rgb_buffer[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
-        //rgb_pixel[5] = bayer_pixel[line_step];
-
-        // BGBG line
-        // Bayer        -1 0 1
-        //          0    r g r
-        //  line_step    g B g
-        // line_step2    r g r
-        rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-        rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-        //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
-
-        // Bayer         -1 0 1
-        //         0      r g r
-        // line_step      g b G
-        // line_step2     r g r
-        rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-        rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-        //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
-
-        bayer_pixel += bayer_line_step + 2;
-        rgb_buffer += rgb_line_step + 6 + rgb_line_skip;
-      }
-
-      //last two lines
-      // Bayer         0 1 2
-      //        -1     b g b
-      //         0     G r g
-      // line_step     b g b
-
-      rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
-      rgb_buffer[1] = bayer_pixel[0]; // green pixel
-      rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
-
-      // Bayer         0 1 2
-      //        -1     b g b
-      //         0     g R g
-      // line_step     b g b
-      //rgb_pixel[3] = bayer_pixel[1];
-      rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-      rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
-
-      // BGBG line
-      // Bayer         0 1 2
-      //        -1     b g b
-      //         0     g r g
-      // line_step     B g b
-      //rgb_pixel[rgb_line_step    ] = bayer_pixel[1];
-      rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
-      rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-
-      // Bayer         0 1 2
-      //        -1     b g b
-      //         0     g r g
-      // line_step     b G b
-      //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
-      rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-      rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-
-      rgb_buffer += 6;
-      bayer_pixel += 2;
-      // rest of the last two lines
-      for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
-      {
-        // GRGR line
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r G r g
-        // line_step    g b g b
-        rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-        rgb_buffer[1] = bayer_pixel[0];
-        rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
-
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r g R g
-        // line_step    g b g b
-        rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-        rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[-bayer_line_step + 2]);
-
-        // BGBG line
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r g r g
-        // line_step    g B g b
-        rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[-1], bayer_pixel[1]);
-        rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-        rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-
-
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r g r g
-        // line_step    g b G b
-        //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
-        rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-        rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-      }
-
-      // last two pixel values for first two lines
-      // GRGR line
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r G r
-      // line_step    g b g
-      rgb_buffer[rgb_line_step ] = rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-      rgb_buffer[1] = bayer_pixel[0];
-      rgb_buffer[5] = rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
-
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r g R
-      // line_step    g b g
-      rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
-      rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[-bayer_line_step + 1]);
-      //rgb_pixel[5] = AVG( bayer_pixel[line_step], bayer_pixel[-line_step] );
-
-      // BGBG line
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r g r
-      // line_step    g B g
-      //rgb_pixel[rgb_line_step    ] = AVG2( bayer_pixel[-1], bayer_pixel[1] );
-      rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-      rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r g r
-      // line_step    g b G
-      //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
-      rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-      //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
     }
-    else if (debayering_method_ == EdgeAwareWeighted)
+  }
+  else if (debayering_method_ == EdgeAware)
+  {
+    int dh, dv;
+    for (yIdx = first_row; yIdx < last_row; yIdx += 2)
     {
-      int dh, dv;
-
-      // first two pixel values for first two lines
+      // first two pixel values
       // Bayer         0 1 2
+      //        -1     b g b
       //         0     G r g
       // line_step     b g b
       // line_step2    g r g
 
       rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
       rgb_buffer[1] = bayer_pixel[0]; // green pixel
-      rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
+      rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]); // blue;
 
       // Bayer         0 1 2
+      //        -1     b g b
       //         0     g R g
       // line_step     b g b
       // line_step2    g r g
       //rgb_pixel[3] = bayer_pixel[1];
-      rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
-      rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+      rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
+      rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
 
       // BGBG line
       // Bayer         0 1 2
@@ -1055,7 +1278,7 @@ void ImageBayerGRBG::fillRGB (unsigned width, unsigned height, unsigned char* rg
       // line_step2    g r g
       rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
       rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
-      //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
+      rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
 
       // pixel (1, 1)  0 1 2
       //         0     g r g
@@ -1063,48 +1286,81 @@ void ImageBayerGRBG::fillRGB (unsigned width, unsigned height, unsigned char* rg
       // line_step2    g r g
       //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
       rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-      //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
+      rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
 
       rgb_buffer += 6;
       bayer_pixel += 2;
-      // rest of the first two lines
-      for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
+      // continue with rest of the line, vectorised as far as possible
+      xIdx = 2;
+      if (row_kernel)
+      {
+        unsigned simd_pixels = row_kernel (bayer_pixel, bayer_line_step, rgb_buffer, rgb_line_step, width - 4);
+        xIdx += simd_pixels;
+        bayer_pixel += simd_pixels;
+        rgb_buffer += simd_pixels * 3;
+      }
+
+      for (; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
       {
         // GRGR line
         // Bayer        -1 0 1 2
+        //          -1   g b g b
         //           0   r G r g
         //   line_step   g b g b
         // line_step2    r g r g
         rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
         rgb_buffer[1] = bayer_pixel[0];
-        rgb_buffer[2] = bayer_pixel[bayer_line_step + 1];
+        rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
 
         // Bayer        -1 0 1 2
+        //          -1   g b g b
         //          0    r g R g
         //  line_step    g b g b
         // line_step2    r g r g
+
+        dh = abs (bayer_pixel[0] - bayer_pixel[2]);
+        dv = abs (bayer_pixel[-bayer_line_step + 1] - bayer_pixel[bayer_line_step + 1]);
+
+        if (dh > dv)
+          rgb_buffer[4] = AVG (bayer_pixel[-bayer_line_step + 1], bayer_pixel[bayer_line_step + 1]);
+        else if (dv > dh)
+          rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[2]);
+        else
+          rgb_buffer[4] = AVG4 (bayer_pixel[-bayer_line_step + 1], bayer_pixel[bayer_line_step + 1], bayer_pixel[0], bayer_pixel[2]);
+
         rgb_buffer[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1]);
-        rgb_buffer[rgb_line_step + 5] = rgb_buffer[5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
+        rgb_buffer[5] = AVG4 (bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step], bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
 
         // BGBG line
         // Bayer         -1 0 1 2
-        //         0      r g r g
+        //         -1     g b g b
+        //          0     r g r g
         // line_step      g B g b
         // line_step2     r g r g
         rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-        rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
         rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
 
+        dv = abs (bayer_pixel[0] - bayer_pixel[bayer_line_step2]);
+        dh = abs (bayer_pixel[bayer_line_step - 1] - bayer_pixel[bayer_line_step + 1]);
+
+        if (dv > dh)
+          rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+        else if (dh > dv)
+          rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step2]);
+        else
+          rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+
         // Bayer         -1 0 1 2
-        //         0      r g r g
+        //         -1     g b g b
+        //          0     r g r g
         // line_step      g b G b
         // line_step2     r g r g
         rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
         rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-        //rgb_pixel[rgb_line_step + 5] = AVG( bayer_pixel[line_step] , bayer_pixel[line_step+2] );
+        rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
       }
 
+      // last two pixels of the line
       // last two pixel values for first two lines
       // GRGR line
       // Bayer        -1 0 1
@@ -1142,278 +1398,155 @@ void ImageBayerGRBG::fillRGB (unsigned width, unsigned height, unsigned char* rg
 
       bayer_pixel += bayer_line_step + 2;
       rgb_buffer += rgb_line_step + 6 + rgb_line_skip;
-      // main processing
-      for (yIdx = 2; yIdx < height - 2; yIdx += 2)
-      {
-        // first two pixel values
-        // Bayer         0 1 2
-        //        -1     b g b
-        //         0     G r g
-        // line_step     b g b
-        // line_step2    g r g
-
-        rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
-        rgb_buffer[1] = bayer_pixel[0]; // green pixel
-        rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]); // blue;
-
-        // Bayer         0 1 2
-        //        -1     b g b
-        //         0     g R g
-        // line_step     b g b
-        // line_step2    g r g
-        //rgb_pixel[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-        rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
-
-        // BGBG line
-        // Bayer         0 1 2
-        //         0     g r g
-        // line_step     B g b
-        // line_step2    g r g
-        rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-        rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
-        rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-
-        // pixel (1, 1)  0 1 2
-        //         0     g r g
-        // line_step     b G b
-        // line_step2    g r g
-        //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
-        rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-        rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-
-        rgb_buffer += 6;
-        bayer_pixel += 2;
-        // continue with rest of the line
-        for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
-        {
-          // GRGR line
-          // Bayer        -1 0 1 2
-          //          -1   g b g b
-          //           0   r G r g
-          //   line_step   g b g b
-          // line_step2    r g r g
-          rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-          rgb_buffer[1] = bayer_pixel[0];
-          rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
-
-          // Bayer        -1 0 1 2
-          //          -1   g b g b
-          //          0    r g R g
-          //  line_step    g b g b
-          // line_step2    r g r g
-
-          dh = abs (bayer_pixel[0] - bayer_pixel[2]);
-          dv = abs (bayer_pixel[-bayer_line_step + 1] - bayer_pixel[bayer_line_step + 1]);
-
-          if (dv == 0 && dh == 0)
-            rgb_buffer[4] = AVG4 (bayer_pixel[1 - bayer_line_step], bayer_pixel[1 + bayer_line_step], bayer_pixel[0], bayer_pixel[2]);
-          else
-            rgb_buffer[4] = WAVG4 (bayer_pixel[1 - bayer_line_step], bayer_pixel[1 + bayer_line_step], bayer_pixel[0], bayer_pixel[2], dh, dv);
-          rgb_buffer[3] = bayer_pixel[1];
-          rgb_buffer[5] = AVG4 (bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step], bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-
-          // BGBG line
-          // Bayer         -1 0 1 2
-          //         -1     g b g b
-          //          0     r g r g
-          // line_step      g B g b
-          // line_step2     r g r g
-          rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-          rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
-
-          dv = abs (bayer_pixel[0] - bayer_pixel[bayer_line_step2]);
-          dh = abs (bayer_pixel[bayer_line_step - 1] - bayer_pixel[bayer_line_step + 1]);
-
-          if (dv == 0 && dh == 0)
-            rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-          else
-            rgb_buffer[rgb_line_step + 1] = WAVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1], dh, dv);
-
-          // Bayer         -1 0 1 2
-          //         -1     g b g b
-          //          0     r g r g
-          // line_step      g b G b
-          // line_step2     r g r g
-          rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-          rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-          rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
-        }
-
-        // last two pixels of the line
-        // last two pixel values for first two lines
-        // GRGR line
-        // Bayer        -1 0 1
-        //           0   r G r
-        //   line_step   g b g
-        // line_step2    r g r
-        rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
-        rgb_buffer[1] = bayer_pixel[0];
-        rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = rgb_buffer[5] = rgb_buffer[2] = bayer_pixel[bayer_line_step];
-
-        // Bayer        -1 0 1
-        //          0    r g R
-        //  line_step    g b g
-        // line_step2    r g r
-        rgb_buffer[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
-        //rgb_pixel[5] = bayer_pixel[line_step];
-
-        // BGBG line
-        // Bayer        -1 0 1
-        //          0    r g r
-        //  line_step    g B g
-        // line_step2    r g r
-        rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
-        rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-        //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
-
-        // Bayer         -1 0 1
-        //         0      r g r
-        // line_step      g b G
-        // line_step2     r g r
-        rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
-        rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
-        //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
-
-        bayer_pixel += bayer_line_step + 2;
-        rgb_buffer += rgb_line_step + 6 + rgb_line_skip;
-      }
-
-      //last two lines
+    }
+  }
+  else if (debayering_method_ == EdgeAwareWeighted)
+  {
+    int dh, dv;
+    for (yIdx = first_row; yIdx < last_row; yIdx += 2)
+    {
+      // first two pixel values
       // Bayer         0 1 2
       //        -1     b g b
       //         0     G r g
       // line_step     b g b
+      // line_step2    g r g
 
-      rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
+      rgb_buffer[3] = rgb_buffer[0] = bayer_pixel[1]; // red pixel
       rgb_buffer[1] = bayer_pixel[0]; // green pixel
-      rgb_buffer[rgb_line_step + 2] = rgb_buffer[2] = bayer_pixel[bayer_line_step]; // blue;
+      rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]); // blue;
 
       // Bayer         0 1 2
       //        -1     b g b
       //         0     g R g
       // line_step     b g b
+      // line_step2    g r g
       //rgb_pixel[3] = bayer_pixel[1];
       rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
       rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step]);
 
       // BGBG line
       // Bayer         0 1 2
-      //        -1     b g b
       //         0     g r g
       // line_step     B g b
-      //rgb_pixel[rgb_line_step    ] = bayer_pixel[1];
-      rgb_buffer[rgb_line_step + 1] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
+      // line_step2    g r g
+      rgb_buffer[rgb_line_step + 3] = rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
+      rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[bayer_line_step2]);
       rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
 
-      // Bayer         0 1 2
-      //        -1     b g b
+      // pixel (1, 1)  0 1 2
       //         0     g r g
       // line_step     b G b
+      // line_step2    g r g
       //rgb_pixel[rgb_line_step + 3] = AVG( bayer_pixel[1] , bayer_pixel[line_step2+1] );
       rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
       rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
 
       rgb_buffer += 6;
       bayer_pixel += 2;
-      // rest of the last two lines
-      for (xIdx = 2; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
+      // continue with rest of the line, vectorised as far as possible
+      xIdx = 2;
+      if (row_kernel)
+      {
+        unsigned simd_pixels = row_kernel (bayer_pixel, bayer_line_step, rgb_buffer, rgb_line_step, width - 4);
+        xIdx += simd_pixels;
+        bayer_pixel += simd_pixels;
+        rgb_buffer += simd_pixels * 3;
+      }
+
+      for (; xIdx < width - 2; xIdx += 2, rgb_buffer += 6, bayer_pixel += 2)
       {
         // GRGR line
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r G r g
-        // line_step    g b g b
+        // Bayer        -1 0 1 2
+        //          -1   g b g b
+        //           0   r G r g
+        //   line_step   g b g b
+        // line_step2    r g r g
         rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
         rgb_buffer[1] = bayer_pixel[0];
         rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
 
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r g R g
-        // line_step    g b g b
-        rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
-        rgb_buffer[4] = AVG4 (bayer_pixel[0], bayer_pixel[2], bayer_pixel[bayer_line_step + 1], bayer_pixel[1 - bayer_line_step]);
-        rgb_buffer[5] = AVG4 (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2], bayer_pixel[-bayer_line_step], bayer_pixel[-bayer_line_step + 2]);
+        // Bayer        -1 0 1 2
+        //          -1   g b g b
+        //          0    r g R g
+        //  line_step    g b g b
+        // line_step2    r g r g
+
+        dh = abs (bayer_pixel[0] - bayer_pixel[2]);
+        dv = abs (bayer_pixel[-bayer_line_step + 1] - bayer_pixel[bayer_line_step + 1]);
+
+        if (dv == 0 && dh == 0)
+          rgb_buffer[4] = AVG4 (bayer_pixel[1 - bayer_line_step], bayer_pixel[1 + bayer_line_step], bayer_pixel[0], bayer_pixel[2]);
+        else
+          rgb_buffer[4] = WAVG4 (bayer_pixel[1 - bayer_line_step], bayer_pixel[1 + bayer_line_step], bayer_pixel[0], bayer_pixel[2], dh, dv);
+        rgb_buffer[3] = bayer_pixel[1];
+        rgb_buffer[5] = AVG4 (bayer_pixel[-bayer_line_step], bayer_pixel[2 - bayer_line_step], bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
 
         // BGBG line
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r g r g
-        // line_step    g B g b
-        rgb_buffer[rgb_line_step ] = AVG (bayer_pixel[-1], bayer_pixel[1]);
-        rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+        // Bayer         -1 0 1 2
+        //         -1     g b g b
+        //          0     r g r g
+        // line_step      g B g b
+        // line_step2     r g r g
+        rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
         rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
 
+        dv = abs (bayer_pixel[0] - bayer_pixel[bayer_line_step2]);
+        dh = abs (bayer_pixel[bayer_line_step - 1] - bayer_pixel[bayer_line_step + 1]);
+
+        if (dv == 0 && dh == 0)
+          rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+        else
+          rgb_buffer[rgb_line_step + 1] = WAVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1], dh, dv);
 
-        // Bayer       -1 0 1 2
-        //        -1    g b g b
-        //         0    r g r g
-        // line_step    g b G b
-        //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
+        // Bayer         -1 0 1 2
+        //         -1     g b g b
+        //          0     r g r g
+        // line_step      g b G b
+        // line_step2     r g r g
+        rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
         rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
         rgb_buffer[rgb_line_step + 5] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[bayer_line_step + 2]);
       }
 
+      // last two pixels of the line
       // last two pixel values for first two lines
       // GRGR line
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r G r
-      // line_step    g b g
-      rgb_buffer[rgb_line_step ] = rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
+      // Bayer        -1 0 1
+      //           0   r G r
+      //   line_step   g b g
+      // line_step2    r g r
+      rgb_buffer[0] = AVG (bayer_pixel[1], bayer_pixel[-1]);
       rgb_buffer[1] = bayer_pixel[0];
-      rgb_buffer[5] = rgb_buffer[2] = AVG (bayer_pixel[bayer_line_step], bayer_pixel[-bayer_line_step]);
+      rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = rgb_buffer[5] = rgb_buffer[2] = bayer_pixel[bayer_line_step];
 
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r g R
-      // line_step    g b g
-      rgb_buffer[rgb_line_step + 3] = rgb_buffer[3] = bayer_pixel[1];
-      rgb_buffer[4] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step + 1], bayer_pixel[-bayer_line_step + 1]);
-      //rgb_pixel[5] = AVG( bayer_pixel[line_step], bayer_pixel[-line_step] );
+      // Bayer        -1 0 1
+      //          0    r g R
+      //  line_step    g b g
+      // line_step2    r g r
+      rgb_buffer[3] = bayer_pixel[1];
+      rgb_buffer[4] = AVG (bayer_pixel[0], bayer_pixel[bayer_line_step + 1]);
+      //rgb_pixel[5] = bayer_pixel[line_step];
 
       // BGBG line
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r g r
-      // line_step    g B g
-      //rgb_pixel[rgb_line_step    ] = AVG2( bayer_pixel[-1], bayer_pixel[1] );
-      rgb_buffer[rgb_line_step + 1] = AVG3 (bayer_pixel[0], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
-      rgb_buffer[rgb_line_step + 5] = rgb_buffer[rgb_line_step + 2] = bayer_pixel[bayer_line_step];
+      // Bayer        -1 0 1
+      //          0    r g r
+      //  line_step    g B g
+      // line_step2    r g r
+      rgb_buffer[rgb_line_step ] = AVG4 (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1], bayer_pixel[-1], bayer_pixel[bayer_line_step2 - 1]);
+      rgb_buffer[rgb_line_step + 1] = AVG4 (bayer_pixel[0], bayer_pixel[bayer_line_step2], bayer_pixel[bayer_line_step - 1], bayer_pixel[bayer_line_step + 1]);
+      //rgb_pixel[rgb_line_step + 2] = bayer_pixel[line_step];
 
-      // Bayer       -1 0 1
-      //        -1    g b g
-      //         0    r g r
-      // line_step    g b G
-      //rgb_pixel[rgb_line_step + 3] = bayer_pixel[1];
+      // Bayer         -1 0 1
+      //         0      r g r
+      // line_step      g b G
+      // line_step2     r g r
+      rgb_buffer[rgb_line_step + 3] = AVG (bayer_pixel[1], bayer_pixel[bayer_line_step2 + 1]);
       rgb_buffer[rgb_line_step + 4] = bayer_pixel[bayer_line_step + 1];
       //rgb_pixel[rgb_line_step + 5] = bayer_pixel[line_step];
-    }
-    else
-      THROW_OPENNI_EXCEPTION ("Unknwon debayering method: %d", (int)debayering_method_);
-  }
-  else
-  {
-    if (image_md_->XRes () % width != 0 || image_md_->YRes () % height != 0)
-      THROW_OPENNI_EXCEPTION ("Downsampling only possible for integer scales in both dimensions. Request was %d x %d -> %d x %d.", image_md_->XRes (), image_md_->YRes (), width, height);
-
-    // get each or each 2nd pixel group to find rgb values!
-    register unsigned bayerXStep = image_md_->XRes () / width;
-    register unsigned bayerYSkip = (image_md_->YRes () / height - 1) * image_md_->XRes ();
-
-    // Downsampling and debayering at once
-    register const XnUInt8* bayer_buffer = image_md_->Data ();
 
-    for (register unsigned yIdx = 0; yIdx < height; ++yIdx, bayer_buffer += bayerYSkip, rgb_buffer += rgb_line_skip) // skip a line
-    {
-      for (register unsigned xIdx = 0; xIdx < width; ++xIdx, rgb_buffer += 3, bayer_buffer += bayerXStep)
-      {
-        rgb_buffer[ 2 ] = bayer_buffer[ image_md_->XRes () ];
-        rgb_buffer[ 1 ] = AVG (bayer_buffer[0], bayer_buffer[ image_md_->XRes () + 1]);
-        rgb_buffer[ 0 ] = bayer_buffer[ 1 ];
-      }
+      bayer_pixel += bayer_line_step + 2;
+      rgb_buffer += rgb_line_step + 6 + rgb_line_skip;
     }
   }
 }
@@ -66,12 +66,32 @@ public:
   }
 
   virtual void fillRGB (unsigned width, unsigned height, unsigned char* rgb_buffer, unsigned rgb_line_step = 0) const throw (OpenNIException);
+  /**
+   * @brief Full resolution RGB for rows first_row to last_row only, written from rgb_buffer on. Both have to be even.
+   *        Converting an image band by band gives the same result as fillRGB, but lets the caller consume each band
+   *        while it is still in cache
+   */
+  void fillRGBBand (unsigned first_row, unsigned last_row, unsigned char* rgb_buffer, unsigned rgb_line_step = 0) const throw (OpenNIException);
   virtual void fillGrayscale (unsigned width, unsigned height, unsigned char* gray_buffer, unsigned gray_line_step = 0) const throw (OpenNIException);
   virtual bool isResizingSupported (unsigned input_width, unsigned input_height, unsigned output_width, unsigned output_height) const;
   inline void setDebayeringMethod (const DebayeringMethod& method) throw ();
   inline DebayeringMethod getDebayeringMethod () const throw ();
   inline static bool resizingSupported (unsigned input_width, unsigned input_height, unsigned output_width, unsigned output_height);
 protected:
+  /**
+   * The full resolution conversions between the first and last two lines,
+   * run in row bands through RowBandPool
+   */
+  void fillGrayscaleRows (unsigned width, unsigned char* gray_image, unsigned gray_line_step, unsigned first_row, unsigned last_row) const;
+  void fillRGBRows (unsigned width, unsigned char* rgb_image, unsigned rgb_line_step, unsigned first_row, unsigned last_row) const;
+  /**
+   * fillRGBRows writing from the output of first_row on, and the first and
+   * last two lines which need their own border handling
+   */
+  void fillRGBLines (unsigned width, unsigned char* rgb_buffer, unsigned rgb_line_step, unsigned first_row, unsigned last_row) const;
+  void fillRGBFirstLines (unsigned width, unsigned char* rgb_buffer, unsigned rgb_line_step) const;
+  void fillRGBLastLines (unsigned width, unsigned height, unsigned char* rgb_buffer, unsigned rgb_line_step) const;
+
   DebayeringMethod debayering_method_;
 };
 
@@ -35,8 +35,11 @@
  *
  */
 #include "openni_image_yuv_422.h"
+#include "openni_simd.h"
+#include "openni_row_band_pool.h"
 #include <sstream>
 #include <iostream>
+#include <boost/bind.hpp>
 
 #define CLIP_CHAR(c) ((c)>255?255:(c)<0?0:(c))
 
@@ -79,24 +82,13 @@ void ImageYUV422::fillRGB (unsigned width, unsigned height, unsigned char* rgb_b
   if (rgb_line_step != 0)
     rgb_line_skip = rgb_line_step - width * 3;
 
+  // SIMD kernels for the bulk of each line, 0 if unavailable
+  const simd::Kernels* kernels = simd::getKernels ();
+
   if (image_md_->XRes() == width && image_md_->YRes() == height)
   {
-    for( register unsigned yIdx = 0; yIdx < height; ++yIdx, rgb_buffer += rgb_line_skip )
-    {
-      for( register unsigned xIdx = 0; xIdx < width; xIdx += 2, rgb_buffer += 6, yuv_buffer += 4 )
-      {
-        int v = yuv_buffer[2] - 128;
-        int u = yuv_buffer[0] - 128;
-
-        rgb_buffer[0] =  CLIP_CHAR (yuv_buffer[1] + ((v * 18678 + 8192 ) >> 14));
-        rgb_buffer[1] =  CLIP_CHAR (yuv_buffer[1] + ((v * -9519 - u * 6472 + 8192 ) >> 14));
-        rgb_buffer[2] =  CLIP_CHAR (yuv_buffer[1] + ((u * 33292 + 8192 ) >> 14));
-
-        rgb_buffer[3] =  CLIP_CHAR (yuv_buffer[3] + ((v * 18678 + 8192 ) >> 14));
-        rgb_buffer[4] =  CLIP_CHAR (yuv_buffer[3] + ((v * -9519 - u * 6472 + 8192 ) >> 14));
-        rgb_buffer[5] =  CLIP_CHAR (yuv_buffer[3] + ((u * 33292 + 8192 ) >> 14));
-      }
-    }
+    // rows are independent, split them into bands
+    RowBandPool::run (0, height, 1, boost::bind (&ImageYUV422::fillRGBRows, this, width, rgb_buffer, rgb_line_skip, _1, _2));
   }
   else
   {
@@ -104,9 +96,23 @@ void ImageYUV422::fillRGB (unsigned width, unsigned height, unsigned char* rgb_b
     register unsigned yuv_x_step = yuv_step << 1;
     register unsigned yuv_skip = (image_md_->YRes() / height - 1) * ( image_md_->XRes() << 1 );
     
+    // The kernel loads whole UYVY groups, which needs the step to keep to them
+    if (yuv_x_step & 0x03)
+      kernels = 0;
+
     for( register unsigned yIdx = 0; yIdx < image_md_->YRes(); yIdx += yuv_step, yuv_buffer += yuv_skip, rgb_buffer += rgb_line_skip )
     {
-      for( register unsigned xIdx = 0; xIdx < image_md_->XRes(); xIdx += yuv_step, rgb_buffer += 3, yuv_buffer += yuv_x_step )
+      register unsigned xIdx = 0;
+
+      if (kernels)
+      {
+        unsigned done = kernels->yuvDownsampledRow (yuv_buffer, yuv_x_step, rgb_buffer, width);
+        xIdx = done * yuv_step;
+        rgb_buffer += done * 3;
+        yuv_buffer += done * yuv_x_step;
+      }
+
+      for( ; xIdx < image_md_->XRes(); xIdx += yuv_step, rgb_buffer += 3, yuv_buffer += yuv_x_step )
       {
         int v = yuv_buffer[2] - 128;
         int u = yuv_buffer[0] - 128;
@@ -119,6 +125,41 @@ void ImageYUV422::fillRGB (unsigned width, unsigned height, unsigned char* rgb_b
   }
 }
 
+void ImageYUV422::fillRGBRows (unsigned width, unsigned char* rgb_image, unsigned rgb_line_skip, unsigned first_row, unsigned last_row) const
+{
+  register const XnUInt8* yuv_buffer = image_md_->Data() + first_row * (width << 1);
+  unsigned char* rgb_buffer = rgb_image + first_row * (width * 3 + rgb_line_skip);
+
+  // SIMD kernel for the bulk of each line, 0 if unavailable
+  const simd::Kernels* kernels = simd::getKernels ();
+
+  for( register unsigned yIdx = first_row; yIdx < last_row; ++yIdx, rgb_buffer += rgb_line_skip )
+  {
+    register unsigned xIdx = 0;
+
+    if (kernels)
+    {
+      xIdx = kernels->yuvRow (yuv_buffer, rgb_buffer, width & ~1u);
+      rgb_buffer += xIdx * 3;
+      yuv_buffer += xIdx << 1;
+    }
+
+    for( ; xIdx < width; xIdx += 2, rgb_buffer += 6, yuv_buffer += 4 )
+    {
+      int v = yuv_buffer[2] - 128;
+      int u = yuv_buffer[0] - 128;
+
+      rgb_buffer[0] =  CLIP_CHAR (yuv_buffer[1] + ((v * 18678 + 8192 ) >> 14));
+      rgb_buffer[1] =  CLIP_CHAR (yuv_buffer[1] + ((v * -9519 - u * 6472 + 8192 ) >> 14));
+      rgb_buffer[2] =  CLIP_CHAR (yuv_buffer[1] + ((u * 33292 + 8192 ) >> 14));
+
+      rgb_buffer[3] =  CLIP_CHAR (yuv_buffer[3] + ((v * 18678 + 8192 ) >> 14));
+      rgb_buffer[4] =  CLIP_CHAR (yuv_buffer[3] + ((v * -9519 - u * 6472 + 8192 ) >> 14));
+      rgb_buffer[5] =  CLIP_CHAR (yuv_buffer[3] + ((u * 33292 + 8192 ) >> 14));
+    }
+  }
+}
+
 void ImageYUV422::fillGrayscale (unsigned width, unsigned height, unsigned char* gray_buffer, unsigned gray_line_step) const throw (OpenNIException)
 {
   // u y1 v y2
@@ -137,9 +178,23 @@ void ImageYUV422::fillGrayscale (unsigned width, unsigned height, unsigned char*
   register unsigned yuv_skip = (image_md_->YRes() / height - 1) * ( image_md_->XRes() << 1 );
   register const XnUInt8* yuv_buffer = (image_md_->Data() + 1);
 
+  // SIMD kernel for the bulk of each line, 0 if unavailable
+  const simd::Kernels* kernels = simd::getKernels ();
+
   for( register unsigned yIdx = 0; yIdx < image_md_->YRes(); yIdx += yuv_step, yuv_buffer += yuv_skip, gray_buffer += gray_line_skip )
   {
-    for( register unsigned xIdx = 0; xIdx < image_md_->XRes(); xIdx += yuv_step, ++gray_buffer, yuv_buffer += yuv_x_step )
+    register unsigned xIdx = 0;
+
+    if (kernels)
+    {
+      // the kernel takes the start of the pixel, one byte before its luma
+      unsigned done = kernels->lumaRow (yuv_buffer - 1, yuv_x_step, gray_buffer, width);
+      xIdx = done * yuv_step;
+      gray_buffer += done;
+      yuv_buffer += done * yuv_x_step;
+    }
+
+    for( ; xIdx < image_md_->XRes(); xIdx += yuv_step, ++gray_buffer, yuv_buffer += yuv_x_step )
     {
       *gray_buffer = *yuv_buffer;
     }
@@ -62,6 +62,12 @@ public:
   virtual void fillRGB (unsigned width, unsigned height, unsigned char* rgb_buffer, unsigned rgb_line_step = 0) const throw (OpenNIException);
   virtual void fillGrayscale (unsigned width, unsigned height, unsigned char* gray_buffer, unsigned gray_line_step = 0) const throw (OpenNIException);
   inline static bool resizingSupported (unsigned input_width, unsigned input_height, unsigned output_width, unsigned output_height);
+protected:
+  /**
+   * Full resolution conversion of the given rows, run in row bands through
+   * RowBandPool
+   */
+  void fillRGBRows (unsigned width, unsigned char* rgb_image, unsigned rgb_line_skip, unsigned first_row, unsigned last_row) const;
 };
 
 bool ImageYUV422::resizingSupported (unsigned input_width, unsigned input_height, unsigned output_width, unsigned output_height)
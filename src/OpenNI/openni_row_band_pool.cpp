@@ -0,0 +1,184 @@
+/*
+ * openni_row_band_pool.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "openni_row_band_pool.h"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+namespace
+{
+
+/**
+ * Bands smaller than this cost more to hand over than they save
+ */
+const unsigned min_band_rows = 32;
+
+class Workers
+{
+public:
+  Workers (unsigned threads)
+  : function_ (0)
+  , first_row_ (0)
+  , last_row_ (0)
+  , row_alignment_ (1)
+  , units_ (0)
+  , bands_ (0)
+  , next_band_ (0)
+  , pending_ (0)
+  , stop_ (false)
+  {
+    for (unsigned i = 1; i < threads; ++i)
+      threads_.create_thread (boost::bind (&Workers::work, this));
+  }
+
+  ~Workers ()
+  {
+    {
+      boost::mutex::scoped_lock lock (mutex_);
+      stop_ = true;
+    }
+
+    wake_.notify_all ();
+    threads_.join_all ();
+  }
+
+  void run (unsigned first_row, unsigned last_row, unsigned row_alignment, unsigned bands,
+            const openni_wrapper::RowBandPool::BandFunction& function)
+  {
+    // One image at a time, a second caller waits for the pool
+    boost::mutex::scoped_lock run_lock (run_mutex_);
+    boost::mutex::scoped_lock lock (mutex_);
+
+    function_ = &function;
+    first_row_ = first_row;
+    last_row_ = last_row;
+    row_alignment_ = row_alignment;
+    units_ = (last_row - first_row + row_alignment - 1) / row_alignment;
+    bands_ = bands;
+    next_band_ = 0;
+    pending_ = bands;
+
+    wake_.notify_all ();
+
+    while (runBand (lock))
+      ;
+
+    while (pending_)
+      done_.wait (lock);
+
+    function_ = 0;
+  }
+
+private:
+  /**
+   * Claims and runs the next band of the current image, if there is one.
+   * The lock is dropped while the band runs
+   */
+  bool runBand (boost::mutex::scoped_lock& lock)
+  {
+    if (next_band_ >= bands_)
+      return false;
+
+    unsigned band = next_band_++;
+
+    unsigned first = first_row_ + band * units_ / bands_ * row_alignment_;
+    unsigned last = std::min (last_row_, first_row_ + (band + 1) * units_ / bands_ * row_alignment_);
+
+    const openni_wrapper::RowBandPool::BandFunction& function = *function_;
+
+    lock.unlock ();
+    function (first, last);
+    lock.lock ();
+
+    if (--pending_ == 0)
+      done_.notify_all ();
+
+    return true;
+  }
+
+  void work ()
+  {
+    boost::mutex::scoped_lock lock (mutex_);
+
+    for (;;)
+    {
+      while (!stop_ && next_band_ >= bands_)
+        wake_.wait (lock);
+
+      if (stop_)
+        return;
+
+      runBand (lock);
+    }
+  }
+
+  boost::thread_group threads_;
+
+  boost::mutex run_mutex_;
+  boost::mutex mutex_;
+  boost::condition_variable wake_;
+  boost::condition_variable done_;
+
+  const openni_wrapper::RowBandPool::BandFunction* function_;
+  unsigned first_row_;
+  unsigned last_row_;
+  unsigned row_alignment_;
+  unsigned units_;
+  unsigned bands_;
+  unsigned next_band_;
+  unsigned pending_;
+  bool stop_;
+};
+
+unsigned thread_count = 1;
+boost::scoped_ptr<Workers> workers;
+
+} // namespace
+
+namespace openni_wrapper
+{
+
+void
+RowBandPool::setThreads (unsigned threads)
+{
+  threads = std::max (threads, 1u);
+
+  if (threads == thread_count)
+    return;
+
+  workers.reset (threads > 1 ? new Workers (threads) : 0);
+  thread_count = threads;
+}
+
+unsigned
+RowBandPool::getThreads ()
+{
+  return thread_count;
+}
+
+void
+RowBandPool::run (unsigned first_row, unsigned last_row, unsigned row_alignment, const BandFunction& function)
+{
+  if (last_row <= first_row)
+    return;
+
+  unsigned bands = std::min (thread_count, (last_row - first_row) / min_band_rows);
+
+  if (!workers || bands < 2)
+  {
+    function (first_row, last_row);
+    return;
+  }
+
+  workers->run (first_row, last_row, row_alignment, bands, function);
+}
+
+} // namespace openni_wrapper
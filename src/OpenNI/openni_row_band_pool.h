@@ -0,0 +1,47 @@
+/*
+ * openni_row_band_pool.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef OPENNI_ROW_BAND_POOL_H_
+#define OPENNI_ROW_BAND_POOL_H_
+
+#include <boost/function.hpp>
+
+namespace openni_wrapper
+{
+
+/**
+ * Splits the rows of an image conversion into bands, run by a pool of
+ * worker threads shared by all images with the calling thread taking a
+ * band as well. A band only writes its own output rows. The rows around
+ * its edges it interpolates from (the halo) are read straight from the
+ * source image, which nothing writes, so the output is the same as a
+ * single pass over the image
+ */
+class RowBandPool
+{
+public:
+  typedef boost::function<void (unsigned first_row, unsigned last_row)> BandFunction;
+
+  /**
+   * Threads, including the caller, the rows of an image are split across.
+   * 1, the default, runs everything in the calling thread. Set it before
+   * any images are filled
+   */
+  static void setThreads (unsigned threads);
+  static unsigned getThreads ();
+
+  /**
+   * Calls function for bands covering [first_row, last_row), each starting
+   * a multiple of row_alignment rows after first_row, and returns once all
+   * of them are done
+   */
+  static void run (unsigned first_row, unsigned last_row, unsigned row_alignment, const BandFunction& function);
+};
+
+} // namespace openni_wrapper
+
+#endif /* OPENNI_ROW_BAND_POOL_H_ */
@@ -0,0 +1,96 @@
+/*
+ * openni_simd.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "openni_simd_kernels.h"
+
+namespace
+{
+
+openni_wrapper::simd::InstructionSet
+detect ()
+{
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__)) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8))
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("avx2") && openni_wrapper::simd::getAvx2Kernels ())
+    return openni_wrapper::simd::AVX2;
+
+  if (__builtin_cpu_supports ("ssse3") && openni_wrapper::simd::getSsse3Kernels ())
+    return openni_wrapper::simd::SSSE3;
+#endif
+
+#ifdef __SSE2__
+  return openni_wrapper::simd::SSE2;
+#else
+  return openni_wrapper::simd::Scalar;
+#endif
+}
+
+bool instruction_set_overridden = false;
+openni_wrapper::simd::InstructionSet instruction_set_override = openni_wrapper::simd::Scalar;
+
+} // namespace
+
+namespace openni_wrapper
+{
+namespace simd
+{
+
+InstructionSet
+detectInstructionSet ()
+{
+  static const InstructionSet instruction_set = detect ();
+
+  return instruction_set;
+}
+
+const Kernels*
+getKernels (InstructionSet instruction_set)
+{
+  switch (instruction_set)
+  {
+    case SSE2:
+      return getSse2Kernels ();
+    case SSSE3:
+      return getSsse3Kernels ();
+    case AVX2:
+      return getAvx2Kernels ();
+    default:
+      return 0;
+  }
+}
+
+const Kernels*
+getKernels ()
+{
+  if (instruction_set_overridden)
+    return getKernels (instruction_set_override);
+
+  static const Kernels* kernels = getKernels (detectInstructionSet ());
+
+  return kernels;
+}
+
+void
+setInstructionSet (InstructionSet instruction_set)
+{
+  instruction_set_override = instruction_set;
+  instruction_set_overridden = true;
+}
+
+const Kernels*
+getSse2Kernels ()
+{
+#ifdef __SSE2__
+  return &KernelTable<Sse2Ops>::kernels;
+#else
+  return 0;
+#endif
+}
+
+} // namespace simd
+} // namespace openni_wrapper
@@ -0,0 +1,133 @@
+/*
+ * openni_simd.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef OPENNI_SIMD_H_
+#define OPENNI_SIMD_H_
+
+namespace openni_wrapper
+{
+namespace simd
+{
+
+typedef enum
+{
+  Scalar = 0,
+  SSE2,
+  SSSE3,
+  AVX2
+} InstructionSet;
+
+/**
+ * Debayers two output rows at once, starting at the green pixel bayer_pixel
+ * of a GRGR row with at least one Bayer row above and two below. Works on
+ * the interior of the image only and returns how many pixels (of at most
+ * pixels) it wrote, the caller finishes the rest with the scalar code. The
+ * output is bit identical to ImageBayerGRBG::fillRGB's scalar loops
+ */
+typedef unsigned (*DebayerRowKernel) (const unsigned char* bayer_pixel, unsigned bayer_line_step,
+                                      unsigned char* rgb_buffer, unsigned rgb_line_step, unsigned pixels);
+
+/**
+ * Converts an even number of UYVY pixels to RGB, returns how many it did
+ */
+typedef unsigned (*YuvRowKernel) (const unsigned char* yuv_buffer, unsigned char* rgb_buffer, unsigned pixels);
+
+/**
+ * Writes one RGB pixel for each UYVY group, yuv_x_step bytes (a multiple
+ * of 4) apart, from the group's first luma. Returns how many it did
+ */
+typedef unsigned (*YuvDownsampledRowKernel) (const unsigned char* yuv_buffer, unsigned yuv_x_step,
+                                             unsigned char* rgb_buffer, unsigned pixels);
+
+/**
+ * Writes the luma of the pixel starting every yuv_x_step bytes (2 for
+ * every pixel, or any larger step) of a UYVY row. Returns how many it did
+ */
+typedef unsigned (*LumaRowKernel) (const unsigned char* yuv_buffer, unsigned yuv_x_step,
+                                   unsigned char* gray_buffer, unsigned pixels);
+
+/**
+ * Depth values besides 0 that mark a pixel as having no measurement. A
+ * DepthImage value that does not fit 16 bits can never match and is
+ * passed as 0
+ */
+struct DepthInvalid
+{
+  unsigned short no_sample;
+  unsigned short shadow;
+};
+
+/**
+ * The depth kernels read the pixel every x_step values of a row of
+ * millimetre depth and write one output per pixel, returning how many
+ * they did. Raw depth is 0 where invalid
+ */
+typedef unsigned (*DepthRawRowKernel) (const unsigned short* depth, unsigned x_step, DepthInvalid invalid,
+                                       unsigned short* depth_buffer, unsigned pixels);
+
+/**
+ * Depth in metres, NaN where invalid
+ */
+typedef unsigned (*DepthRowKernel) (const unsigned short* depth, unsigned x_step, DepthInvalid invalid,
+                                    float* depth_buffer, unsigned pixels);
+
+/**
+ * constant / depth, 0 where invalid
+ */
+typedef unsigned (*DisparityRowKernel) (const unsigned short* depth, unsigned x_step, DepthInvalid invalid,
+                                        float constant, float* disparity_buffer, unsigned pixels);
+
+/**
+ * All kernels of one instruction set. Their output is bit identical to the
+ * scalar code they replace
+ */
+struct Kernels
+{
+  DebayerRowKernel debayer[3]; // indexed by ImageBayerGRBG::DebayeringMethod
+  YuvRowKernel yuvRow;
+  YuvDownsampledRowKernel yuvDownsampledRow;
+  LumaRowKernel lumaRow;
+  DepthRawRowKernel depthRawRow;
+  DepthRowKernel depthRow;
+  DisparityRowKernel disparityRow;
+};
+
+/**
+ * Best instruction set both this build and the CPU support, checked once
+ */
+InstructionSet detectInstructionSet ();
+
+/**
+ * Kernels for an instruction set, or 0 if it is Scalar or not compiled in
+ */
+const Kernels* getKernels (InstructionSet instruction_set);
+
+/**
+ * Kernels for detectInstructionSet (), or for the instruction set passed
+ * to setInstructionSet ()
+ */
+const Kernels* getKernels ();
+
+/**
+ * Makes getKernels () return the kernels of another instruction set, so
+ * the converters can be checked against the scalar code. Scalar turns
+ * the kernels off. Only for tests, not safe while anything is converting
+ */
+void setInstructionSet (InstructionSet instruction_set);
+
+/**
+ * Per instruction set kernels, each compiled in its own translation unit
+ * with the flags it needs
+ */
+const Kernels* getSse2Kernels ();
+const Kernels* getSsse3Kernels ();
+const Kernels* getAvx2Kernels ();
+
+} // namespace simd
+} // namespace openni_wrapper
+
+#endif /* OPENNI_SIMD_H_ */
@@ -0,0 +1,29 @@
+/*
+ * openni_simd_avx2.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "openni_simd_kernels.h"
+
+namespace openni_wrapper
+{
+namespace simd
+{
+
+/**
+ * Built with -mavx2, only called once the CPU is known to support it
+ */
+const Kernels*
+getAvx2Kernels ()
+{
+#ifdef __AVX2__
+  return &KernelTable<Avx2Ops, Ssse3Ops>::kernels;
+#else
+  return 0;
+#endif
+}
+
+} // namespace simd
+} // namespace openni_wrapper
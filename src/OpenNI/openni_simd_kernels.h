@@ -0,0 +1,760 @@
+/*
+ * openni_simd_kernels.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef OPENNI_SIMD_KERNELS_H_
+#define OPENNI_SIMD_KERNELS_H_
+
+/**
+ * Implementation of the debayer and YUV kernels, only included by the
+ * openni_simd*.cpp files. Each of them is built with different instruction
+ * set flags, so everything here has internal linkage
+ */
+
+#include "openni_image_bayer_grbg.h"
+#include "openni_simd.h"
+
+#include <cstring>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+/**
+ * Green at a red or blue pixel, from its vertical (a, b) and horizontal
+ * (c, d) neighbours, mirroring the scalar AVG / AVG4 / WAVG4 choices
+ */
+template <class Ops, int Method> inline typename Ops::Vector
+interpolateGreen (typename Ops::Vector a, typename Ops::Vector b, typename Ops::Vector c, typename Ops::Vector d)
+{
+  typedef typename Ops::Vector Vector;
+
+  Vector vertical = Ops::add (a, b);
+  Vector horizontal = Ops::add (c, d);
+  Vector average = Ops::quarter (Ops::add (vertical, horizontal));
+
+  if (Method == openni_wrapper::ImageBayerGRBG::Bilinear)
+    return average;
+
+  Vector dv = Ops::absDiff (a, b);
+  Vector dh = Ops::absDiff (c, d);
+
+  if (Method == openni_wrapper::ImageBayerGRBG::EdgeAware)
+    return Ops::select (Ops::greater (dh, dv), Ops::half (vertical),
+                        Ops::select (Ops::greater (dv, dh), Ops::half (horizontal), average));
+
+  Vector flat = Ops::equal (Ops::add (dh, dv), Ops::zero ());
+
+  return Ops::select (flat, average, Ops::weighted (vertical, horizontal, dh, dv));
+}
+
+template <class Ops, int Method> unsigned
+debayerRows (const unsigned char* bayer_pixel, unsigned bayer_line_step,
+             unsigned char* rgb_buffer, unsigned rgb_line_step, unsigned pixels)
+{
+  typedef typename Ops::Vector Vector;
+
+  unsigned done = 0;
+
+  // Each 16 bit lane holds one 2x2 block, the value of the Bayer pixel at
+  // an (even) offset from the block's green pixel:
+  // Bayer        -1 0 1 2
+  //          -1   g b g b     up
+  //           0   r G r g     mid
+  //   line_step   g b g b     down
+  // line_step2    r g r g     down2
+  for (; done + Ops::Pixels <= pixels; done += Ops::Pixels, bayer_pixel += Ops::Pixels, rgb_buffer += Ops::Pixels * 3)
+  {
+    const unsigned char* up = bayer_pixel - bayer_line_step;
+    const unsigned char* down = bayer_pixel + bayer_line_step;
+    const unsigned char* down2 = down + bayer_line_step;
+
+    Vector up0 = Ops::load (up);
+    Vector up1 = Ops::load (up + 1);
+    Vector up2 = Ops::load (up + 2);
+
+    Vector mid_1 = Ops::load (bayer_pixel - 1);
+    Vector mid0 = Ops::load (bayer_pixel);
+    Vector mid1 = Ops::load (bayer_pixel + 1);
+    Vector mid2 = Ops::load (bayer_pixel + 2);
+
+    Vector down_1 = Ops::load (down - 1);
+    Vector down0 = Ops::load (down);
+    Vector down1 = Ops::load (down + 1);
+    Vector down2_ = Ops::load (down + 2);
+
+    Vector down2_1 = Ops::load (down2 - 1);
+    Vector down20 = Ops::load (down2);
+    Vector down21 = Ops::load (down2 + 1);
+
+    // GRGR line
+    Vector r0 = Ops::half (Ops::add (mid1, mid_1));
+    Vector g0 = mid0;
+    Vector b0 = Ops::half (Ops::add (down0, up0));
+
+    Vector r1 = mid1;
+    Vector g1 = interpolateGreen<Ops, Method> (up1, down1, mid0, mid2);
+    Vector b1 = Ops::quarter (Ops::add (Ops::add (up0, up2), Ops::add (down0, down2_)));
+
+    Ops::store (rgb_buffer, Ops::combine (r0, r1), Ops::combine (g0, g1), Ops::combine (b0, b1));
+
+    // BGBG line
+    r0 = Ops::quarter (Ops::add (Ops::add (mid1, down21), Ops::add (mid_1, down2_1)));
+    g0 = interpolateGreen<Ops, Method> (mid0, down20, down_1, down1);
+    b0 = down0;
+
+    r1 = Ops::half (Ops::add (mid1, down21));
+    g1 = down1;
+    b1 = Ops::half (Ops::add (down0, down2_));
+
+    Ops::store (rgb_buffer + rgb_line_step, Ops::combine (r0, r1), Ops::combine (g0, g1), Ops::combine (b0, b1));
+  }
+
+  return done;
+}
+
+#ifdef __SSE2__
+/**
+ * 8 blocks (16 pixels) per vector. Loads take the even bytes of an
+ * unaligned 16 byte load as 16 bit lanes, all arithmetic stays within
+ * 16 bits except the weighted average, which is done in float. Its
+ * operands are exact in float and never land within rounding distance
+ * of an integer, so truncating matches the scalar integer division
+ */
+struct Sse2Base
+{
+  typedef __m128i Vector;
+
+  static const unsigned Pixels = 16;
+
+  static inline Vector load (const unsigned char* pixel)
+  {
+    return _mm_and_si128 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (pixel)), _mm_set1_epi16 (0x00ff));
+  }
+
+  static inline Vector zero ()
+  {
+    return _mm_setzero_si128 ();
+  }
+
+  static inline Vector add (Vector a, Vector b)
+  {
+    return _mm_add_epi16 (a, b);
+  }
+
+  static inline Vector half (Vector a)
+  {
+    return _mm_srli_epi16 (a, 1);
+  }
+
+  static inline Vector quarter (Vector a)
+  {
+    return _mm_srli_epi16 (a, 2);
+  }
+
+  static inline Vector absDiff (Vector a, Vector b)
+  {
+    return _mm_sub_epi16 (_mm_max_epi16 (a, b), _mm_min_epi16 (a, b));
+  }
+
+  static inline Vector greater (Vector a, Vector b)
+  {
+    return _mm_cmpgt_epi16 (a, b);
+  }
+
+  static inline Vector equal (Vector a, Vector b)
+  {
+    return _mm_cmpeq_epi16 (a, b);
+  }
+
+  static inline Vector select (Vector mask, Vector a, Vector b)
+  {
+    return _mm_or_si128 (_mm_and_si128 (mask, a), _mm_andnot_si128 (mask, b));
+  }
+
+  /**
+   * (vertical * dh + horizontal * dv) / (2 * (dh + dv))
+   */
+  static inline Vector weighted (Vector vertical, Vector horizontal, Vector dh, Vector dv)
+  {
+    Vector denominator = _mm_max_epi16 (_mm_add_epi16 (dh, dv), _mm_set1_epi16 (1));
+    denominator = _mm_add_epi16 (denominator, denominator);
+
+    __m128 low = _mm_div_ps (_mm_cvtepi32_ps (_mm_madd_epi16 (_mm_unpacklo_epi16 (vertical, horizontal), _mm_unpacklo_epi16 (dh, dv))),
+                             _mm_cvtepi32_ps (_mm_unpacklo_epi16 (denominator, _mm_setzero_si128 ())));
+    __m128 high = _mm_div_ps (_mm_cvtepi32_ps (_mm_madd_epi16 (_mm_unpackhi_epi16 (vertical, horizontal), _mm_unpackhi_epi16 (dh, dv))),
+                              _mm_cvtepi32_ps (_mm_unpackhi_epi16 (denominator, _mm_setzero_si128 ())));
+
+    return _mm_packs_epi32 (_mm_cvttps_epi32 (low), _mm_cvttps_epi32 (high));
+  }
+
+  /**
+   * Even pixels in the low byte of each lane, odd pixels in the high one,
+   * giving 16 bytes in pixel order
+   */
+  static inline Vector combine (Vector even, Vector odd)
+  {
+    return _mm_or_si128 (even, _mm_slli_epi16 (odd, 8));
+  }
+};
+
+/**
+ * Without pshufb the interleave is done through the stack, the arithmetic
+ * is still vectorised
+ */
+struct Sse2Ops : Sse2Base
+{
+  static inline void store (unsigned char* rgb_buffer, Vector r, Vector g, Vector b)
+  {
+    union
+    {
+      __m128i vector[3];
+      unsigned char bytes[3][16];
+    } planes;
+
+    _mm_store_si128 (&planes.vector[0], r);
+    _mm_store_si128 (&planes.vector[1], g);
+    _mm_store_si128 (&planes.vector[2], b);
+
+    for (unsigned i = 0; i < 16; ++i, rgb_buffer += 3)
+    {
+      rgb_buffer[0] = planes.bytes[0][i];
+      rgb_buffer[1] = planes.bytes[1][i];
+      rgb_buffer[2] = planes.bytes[2][i];
+    }
+  }
+};
+
+/**
+ * Packs a u and a v coefficient into each 32 bit lane, for madd against
+ * the (u - 128, v - 128) pairs of a UYVY group
+ */
+inline __m128i
+chromaCoefficients (short u, short v)
+{
+  return _mm_set1_epi32 (static_cast<int> ((static_cast<unsigned> (static_cast<unsigned short> (v)) << 16) | static_cast<unsigned short> (u)));
+}
+
+/**
+ * The chroma terms ImageYUV422::fillRGB adds to luma, for the 4 UYVY
+ * groups of a vector, one per 32 bit lane:
+ *   r = (v * 18678 + 8192) >> 14
+ *   g = (v * -9519 - u * 6472 + 8192) >> 14
+ *   b = (u * 33292 + 8192) >> 14
+ * Each is one madd, except blue's 33292 which needs two 16 bit halves
+ */
+inline void
+chromaTerms (__m128i uyvy, __m128i& r, __m128i& g, __m128i& b)
+{
+  __m128i uv = _mm_sub_epi16 (_mm_and_si128 (uyvy, _mm_set1_epi16 (0x00ff)), _mm_set1_epi16 (128));
+  __m128i round = _mm_set1_epi32 (8192);
+
+  r = _mm_srai_epi32 (_mm_add_epi32 (_mm_madd_epi16 (uv, chromaCoefficients (0, 18678)), round), 14);
+  g = _mm_srai_epi32 (_mm_add_epi32 (_mm_madd_epi16 (uv, chromaCoefficients (-6472, -9519)), round), 14);
+  b = _mm_srai_epi32 (_mm_add_epi32 (_mm_add_epi32 (_mm_madd_epi16 (uv, chromaCoefficients (16384, 0)),
+                                                    _mm_madd_epi16 (uv, chromaCoefficients (16908, 0))), round), 14);
+}
+
+/**
+ * 8 pixels of UYVY to R, G and B in 16 bit lanes, not yet clipped. Each
+ * chroma term fits 16 bits and is copied to both pixels of its group
+ */
+inline void
+yuvToRgb (__m128i uyvy, __m128i& r, __m128i& g, __m128i& b)
+{
+  __m128i y = _mm_srli_epi16 (uyvy, 8);
+  __m128i low = _mm_set1_epi32 (0xffff);
+
+  chromaTerms (uyvy, r, g, b);
+
+  r = _mm_add_epi16 (y, _mm_or_si128 (_mm_and_si128 (r, low), _mm_slli_epi32 (r, 16)));
+  g = _mm_add_epi16 (y, _mm_or_si128 (_mm_and_si128 (g, low), _mm_slli_epi32 (g, 16)));
+  b = _mm_add_epi16 (y, _mm_or_si128 (_mm_and_si128 (b, low), _mm_slli_epi32 (b, 16)));
+}
+
+/**
+ * 4 UYVY groups yuv_x_step bytes apart, one per 32 bit lane
+ */
+inline __m128i
+loadGroups (const unsigned char* yuv_buffer, unsigned yuv_x_step)
+{
+  if (yuv_x_step == 4)
+    return _mm_loadu_si128 (reinterpret_cast<const __m128i*> (yuv_buffer));
+
+  int groups[4];
+
+  for (unsigned i = 0; i < 4; ++i)
+    memcpy (&groups[i], yuv_buffer + i * yuv_x_step, sizeof (int));
+
+  return _mm_loadu_si128 (reinterpret_cast<const __m128i*> (groups));
+}
+
+/**
+ * First luma of each group
+ */
+inline __m128i
+groupLuma (__m128i uyvy)
+{
+  return _mm_and_si128 (_mm_srli_epi32 (uyvy, 8), _mm_set1_epi32 (0xff));
+}
+
+/**
+ * 16 values in 32 bit lanes to 16 clipped bytes, the packs saturation is
+ * CLIP_CHAR
+ */
+inline __m128i
+packClipped (const __m128i* values)
+{
+  return _mm_packus_epi16 (_mm_packs_epi32 (values[0], values[1]), _mm_packs_epi32 (values[2], values[3]));
+}
+
+template <class Ops> unsigned
+yuvRow (const unsigned char* yuv_buffer, unsigned char* rgb_buffer, unsigned pixels)
+{
+  unsigned done = 0;
+
+  for (; done + 16 <= pixels; done += 16, yuv_buffer += 32, rgb_buffer += 48)
+  {
+    __m128i r0, g0, b0, r1, g1, b1;
+
+    yuvToRgb (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (yuv_buffer)), r0, g0, b0);
+    yuvToRgb (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (yuv_buffer + 16)), r1, g1, b1);
+
+    Ops::store (rgb_buffer, _mm_packus_epi16 (r0, r1), _mm_packus_epi16 (g0, g1), _mm_packus_epi16 (b0, b1));
+  }
+
+  return done;
+}
+
+template <class Ops> unsigned
+yuvDownsampledRow (const unsigned char* yuv_buffer, unsigned yuv_x_step, unsigned char* rgb_buffer, unsigned pixels)
+{
+  unsigned done = 0;
+
+  for (; done + 16 <= pixels; done += 16, yuv_buffer += 16 * yuv_x_step, rgb_buffer += 48)
+  {
+    __m128i r[4], g[4], b[4];
+
+    for (unsigned i = 0; i < 4; ++i)
+    {
+      __m128i uyvy = loadGroups (yuv_buffer + 4 * i * yuv_x_step, yuv_x_step);
+      __m128i y = groupLuma (uyvy);
+
+      chromaTerms (uyvy, r[i], g[i], b[i]);
+
+      r[i] = _mm_add_epi32 (y, r[i]);
+      g[i] = _mm_add_epi32 (y, g[i]);
+      b[i] = _mm_add_epi32 (y, b[i]);
+    }
+
+    Ops::store (rgb_buffer, packClipped (r), packClipped (g), packClipped (b));
+  }
+
+  return done;
+}
+
+template <class Ops> unsigned
+lumaRow (const unsigned char* yuv_buffer, unsigned yuv_x_step, unsigned char* gray_buffer, unsigned pixels)
+{
+  unsigned done = 0;
+
+  if (yuv_x_step == 2)
+  {
+    for (; done + 16 <= pixels; done += 16, yuv_buffer += 32, gray_buffer += 16)
+    {
+      __m128i y0 = _mm_srli_epi16 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (yuv_buffer)), 8);
+      __m128i y1 = _mm_srli_epi16 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (yuv_buffer + 16)), 8);
+
+      _mm_storeu_si128 (reinterpret_cast<__m128i*> (gray_buffer), _mm_packus_epi16 (y0, y1));
+    }
+  }
+  else
+  {
+    for (; done + 16 <= pixels; done += 16, yuv_buffer += 16 * yuv_x_step, gray_buffer += 16)
+    {
+      __m128i y[4];
+
+      for (unsigned i = 0; i < 4; ++i)
+        y[i] = groupLuma (loadGroups (yuv_buffer + 4 * i * yuv_x_step, yuv_x_step));
+
+      _mm_storeu_si128 (reinterpret_cast<__m128i*> (gray_buffer), packClipped (y));
+    }
+  }
+
+  return done;
+}
+
+/**
+ * 8 depth values x_step apart. Steps of 1 and 2 are plain loads, the low
+ * halves of 32 bit lanes are sign extended so packs keeps their bits
+ */
+inline __m128i
+loadDepth (const unsigned short* depth, unsigned x_step)
+{
+  if (x_step == 1)
+    return _mm_loadu_si128 (reinterpret_cast<const __m128i*> (depth));
+
+  if (x_step == 2)
+  {
+    __m128i low = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (depth));
+    __m128i high = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (depth + 8));
+
+    return _mm_packs_epi32 (_mm_srai_epi32 (_mm_slli_epi32 (low, 16), 16), _mm_srai_epi32 (_mm_slli_epi32 (high, 16), 16));
+  }
+
+  unsigned short values[8];
+
+  for (unsigned i = 0; i < 8; ++i)
+    values[i] = depth[i * x_step];
+
+  return _mm_loadu_si128 (reinterpret_cast<const __m128i*> (values));
+}
+
+/**
+ * All ones in the 16 bit lanes of depth values that are 0, no sample or
+ * shadow
+ */
+inline __m128i
+invalidDepth (__m128i depth, openni_wrapper::simd::DepthInvalid invalid)
+{
+  return _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi16 (depth, _mm_setzero_si128 ()),
+                                     _mm_cmpeq_epi16 (depth, _mm_set1_epi16 (static_cast<short> (invalid.no_sample)))),
+                       _mm_cmpeq_epi16 (depth, _mm_set1_epi16 (static_cast<short> (invalid.shadow))));
+}
+
+/**
+ * Where mask is set takes a, elsewhere b
+ */
+inline __m128
+selectFloat (__m128i mask, __m128 a, __m128 b)
+{
+  __m128 select = _mm_castsi128_ps (mask);
+
+  return _mm_or_ps (_mm_and_ps (select, a), _mm_andnot_ps (select, b));
+}
+
+template <class Ops> unsigned
+depthRawRow (const unsigned short* depth, unsigned x_step, openni_wrapper::simd::DepthInvalid invalid,
+             unsigned short* depth_buffer, unsigned pixels)
+{
+  unsigned done = 0;
+
+  for (; done + 8 <= pixels; done += 8, depth += 8 * x_step, depth_buffer += 8)
+  {
+    __m128i values = loadDepth (depth, x_step);
+
+    _mm_storeu_si128 (reinterpret_cast<__m128i*> (depth_buffer), _mm_andnot_si128 (invalidDepth (values, invalid), values));
+  }
+
+  return done;
+}
+
+template <class Ops> unsigned
+depthRow (const unsigned short* depth, unsigned x_step, openni_wrapper::simd::DepthInvalid invalid,
+          float* depth_buffer, unsigned pixels)
+{
+  unsigned done = 0;
+
+  const __m128 scale = _mm_set1_ps (0.001f);
+  const __m128 bad_point = _mm_set1_ps (std::numeric_limits<float>::quiet_NaN ());
+
+  for (; done + 8 <= pixels; done += 8, depth += 8 * x_step, depth_buffer += 8)
+  {
+    __m128i values = loadDepth (depth, x_step);
+    __m128i mask = invalidDepth (values, invalid);
+
+    __m128 low = _mm_mul_ps (_mm_cvtepi32_ps (_mm_unpacklo_epi16 (values, _mm_setzero_si128 ())), scale);
+    __m128 high = _mm_mul_ps (_mm_cvtepi32_ps (_mm_unpackhi_epi16 (values, _mm_setzero_si128 ())), scale);
+
+    _mm_storeu_ps (depth_buffer, selectFloat (_mm_unpacklo_epi16 (mask, mask), bad_point, low));
+    _mm_storeu_ps (depth_buffer + 4, selectFloat (_mm_unpackhi_epi16 (mask, mask), bad_point, high));
+  }
+
+  return done;
+}
+
+/**
+ * Invalid pixels divide by 0 too, the result is masked out
+ */
+template <class Ops> unsigned
+disparityRow (const unsigned short* depth, unsigned x_step, openni_wrapper::simd::DepthInvalid invalid,
+              float constant, float* disparity_buffer, unsigned pixels)
+{
+  unsigned done = 0;
+
+  const __m128 numerator = _mm_set1_ps (constant);
+
+  for (; done + 8 <= pixels; done += 8, depth += 8 * x_step, disparity_buffer += 8)
+  {
+    __m128i values = loadDepth (depth, x_step);
+    __m128i mask = invalidDepth (values, invalid);
+
+    __m128 low = _mm_div_ps (numerator, _mm_cvtepi32_ps (_mm_unpacklo_epi16 (values, _mm_setzero_si128 ())));
+    __m128 high = _mm_div_ps (numerator, _mm_cvtepi32_ps (_mm_unpackhi_epi16 (values, _mm_setzero_si128 ())));
+
+    _mm_storeu_ps (disparity_buffer, selectFloat (_mm_unpacklo_epi16 (mask, mask), _mm_setzero_ps (), low));
+    _mm_storeu_ps (disparity_buffer + 4, selectFloat (_mm_unpackhi_epi16 (mask, mask), _mm_setzero_ps (), high));
+  }
+
+  return done;
+}
+#endif
+
+#ifdef __SSSE3__
+/**
+ * Interleaves 16 bytes each of R, G and B into 48 bytes of RGB
+ */
+inline void
+storeInterleaved (unsigned char* rgb_buffer, __m128i r, __m128i g, __m128i b)
+{
+  const char z = -128;
+
+  __m128i out0 = _mm_or_si128 (_mm_or_si128 (_mm_shuffle_epi8 (r, _mm_setr_epi8 (0, z, z, 1, z, z, 2, z, z, 3, z, z, 4, z, z, 5)),
+                                             _mm_shuffle_epi8 (g, _mm_setr_epi8 (z, 0, z, z, 1, z, z, 2, z, z, 3, z, z, 4, z, z))),
+                               _mm_shuffle_epi8 (b, _mm_setr_epi8 (z, z, 0, z, z, 1, z, z, 2, z, z, 3, z, z, 4, z)));
+  __m128i out1 = _mm_or_si128 (_mm_or_si128 (_mm_shuffle_epi8 (r, _mm_setr_epi8 (z, z, 6, z, z, 7, z, z, 8, z, z, 9, z, z, 10, z)),
+                                             _mm_shuffle_epi8 (g, _mm_setr_epi8 (5, z, z, 6, z, z, 7, z, z, 8, z, z, 9, z, z, 10))),
+                               _mm_shuffle_epi8 (b, _mm_setr_epi8 (z, 5, z, z, 6, z, z, 7, z, z, 8, z, z, 9, z, z)));
+  __m128i out2 = _mm_or_si128 (_mm_or_si128 (_mm_shuffle_epi8 (r, _mm_setr_epi8 (z, 11, z, z, 12, z, z, 13, z, z, 14, z, z, 15, z, z)),
+                                             _mm_shuffle_epi8 (g, _mm_setr_epi8 (z, z, 11, z, z, 12, z, z, 13, z, z, 14, z, z, 15, z))),
+                               _mm_shuffle_epi8 (b, _mm_setr_epi8 (10, z, z, 11, z, z, 12, z, z, 13, z, z, 14, z, z, 15)));
+
+  _mm_storeu_si128 (reinterpret_cast<__m128i*> (rgb_buffer), out0);
+  _mm_storeu_si128 (reinterpret_cast<__m128i*> (rgb_buffer + 16), out1);
+  _mm_storeu_si128 (reinterpret_cast<__m128i*> (rgb_buffer + 32), out2);
+}
+
+struct Ssse3Ops : Sse2Base
+{
+  static inline void store (unsigned char* rgb_buffer, Vector r, Vector g, Vector b)
+  {
+    storeInterleaved (rgb_buffer, r, g, b);
+  }
+};
+#endif
+
+#ifdef __AVX2__
+/**
+ * Same as Sse2Base with 16 blocks (32 pixels) per vector. Every operation
+ * used stays within 128 bit lanes, so the two halves are independent
+ */
+struct Avx2Ops
+{
+  typedef __m256i Vector;
+
+  static const unsigned Pixels = 32;
+
+  static inline Vector load (const unsigned char* pixel)
+  {
+    return _mm256_and_si256 (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (pixel)), _mm256_set1_epi16 (0x00ff));
+  }
+
+  static inline Vector zero ()
+  {
+    return _mm256_setzero_si256 ();
+  }
+
+  static inline Vector add (Vector a, Vector b)
+  {
+    return _mm256_add_epi16 (a, b);
+  }
+
+  static inline Vector half (Vector a)
+  {
+    return _mm256_srli_epi16 (a, 1);
+  }
+
+  static inline Vector quarter (Vector a)
+  {
+    return _mm256_srli_epi16 (a, 2);
+  }
+
+  static inline Vector absDiff (Vector a, Vector b)
+  {
+    return _mm256_sub_epi16 (_mm256_max_epi16 (a, b), _mm256_min_epi16 (a, b));
+  }
+
+  static inline Vector greater (Vector a, Vector b)
+  {
+    return _mm256_cmpgt_epi16 (a, b);
+  }
+
+  static inline Vector equal (Vector a, Vector b)
+  {
+    return _mm256_cmpeq_epi16 (a, b);
+  }
+
+  static inline Vector select (Vector mask, Vector a, Vector b)
+  {
+    return _mm256_blendv_epi8 (b, a, mask);
+  }
+
+  static inline Vector weighted (Vector vertical, Vector horizontal, Vector dh, Vector dv)
+  {
+    Vector denominator = _mm256_max_epi16 (_mm256_add_epi16 (dh, dv), _mm256_set1_epi16 (1));
+    denominator = _mm256_add_epi16 (denominator, denominator);
+
+    __m256 low = _mm256_div_ps (_mm256_cvtepi32_ps (_mm256_madd_epi16 (_mm256_unpacklo_epi16 (vertical, horizontal), _mm256_unpacklo_epi16 (dh, dv))),
+                                _mm256_cvtepi32_ps (_mm256_unpacklo_epi16 (denominator, _mm256_setzero_si256 ())));
+    __m256 high = _mm256_div_ps (_mm256_cvtepi32_ps (_mm256_madd_epi16 (_mm256_unpackhi_epi16 (vertical, horizontal), _mm256_unpackhi_epi16 (dh, dv))),
+                                 _mm256_cvtepi32_ps (_mm256_unpackhi_epi16 (denominator, _mm256_setzero_si256 ())));
+
+    return _mm256_packs_epi32 (_mm256_cvttps_epi32 (low), _mm256_cvttps_epi32 (high));
+  }
+
+  static inline Vector combine (Vector even, Vector odd)
+  {
+    return _mm256_or_si256 (even, _mm256_slli_epi16 (odd, 8));
+  }
+
+  static inline void store (unsigned char* rgb_buffer, Vector r, Vector g, Vector b)
+  {
+    storeInterleaved (rgb_buffer, _mm256_castsi256_si128 (r), _mm256_castsi256_si128 (g), _mm256_castsi256_si128 (b));
+    storeInterleaved (rgb_buffer + 48, _mm256_extracti128_si256 (r, 1), _mm256_extracti128_si256 (g, 1), _mm256_extracti128_si256 (b, 1));
+  }
+};
+
+inline void
+chromaTerms (__m256i uyvy, __m256i& r, __m256i& g, __m256i& b)
+{
+  __m256i uv = _mm256_sub_epi16 (_mm256_and_si256 (uyvy, _mm256_set1_epi16 (0x00ff)), _mm256_set1_epi16 (128));
+  __m256i round = _mm256_set1_epi32 (8192);
+
+  r = _mm256_srai_epi32 (_mm256_add_epi32 (_mm256_madd_epi16 (uv, _mm256_broadcastsi128_si256 (chromaCoefficients (0, 18678))), round), 14);
+  g = _mm256_srai_epi32 (_mm256_add_epi32 (_mm256_madd_epi16 (uv, _mm256_broadcastsi128_si256 (chromaCoefficients (-6472, -9519))), round), 14);
+  b = _mm256_srai_epi32 (_mm256_add_epi32 (_mm256_add_epi32 (_mm256_madd_epi16 (uv, _mm256_broadcastsi128_si256 (chromaCoefficients (16384, 0))),
+                                                             _mm256_madd_epi16 (uv, _mm256_broadcastsi128_si256 (chromaCoefficients (16908, 0)))), round), 14);
+}
+
+inline void
+yuvToRgb (__m256i uyvy, __m256i& r, __m256i& g, __m256i& b)
+{
+  __m256i y = _mm256_srli_epi16 (uyvy, 8);
+  __m256i low = _mm256_set1_epi32 (0xffff);
+
+  chromaTerms (uyvy, r, g, b);
+
+  r = _mm256_add_epi16 (y, _mm256_or_si256 (_mm256_and_si256 (r, low), _mm256_slli_epi32 (r, 16)));
+  g = _mm256_add_epi16 (y, _mm256_or_si256 (_mm256_and_si256 (g, low), _mm256_slli_epi32 (g, 16)));
+  b = _mm256_add_epi16 (y, _mm256_or_si256 (_mm256_and_si256 (b, low), _mm256_slli_epi32 (b, 16)));
+}
+
+/**
+ * The lane wise packs leave the 16 bit inputs as pixels 0-7, 16-23, 8-15,
+ * 24-31, swap the middle quarters back
+ */
+inline __m256i
+packClipped (__m256i first, __m256i second)
+{
+  return _mm256_permute4x64_epi64 (_mm256_packus_epi16 (first, second), 0xd8);
+}
+
+/**
+ * As above from 32 bit lanes, which come out of the two packs in groups
+ * of four as pixels 0, 8, 16, 24, 4, 12, 20, 28
+ */
+inline __m256i
+packClipped (const __m256i* values)
+{
+  return _mm256_permutevar8x32_epi32 (_mm256_packus_epi16 (_mm256_packs_epi32 (values[0], values[1]), _mm256_packs_epi32 (values[2], values[3])),
+                                      _mm256_setr_epi32 (0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+template <> unsigned
+yuvRow<Avx2Ops> (const unsigned char* yuv_buffer, unsigned char* rgb_buffer, unsigned pixels)
+{
+  unsigned done = 0;
+
+  for (; done + 32 <= pixels; done += 32, yuv_buffer += 64, rgb_buffer += 96)
+  {
+    __m256i r0, g0, b0, r1, g1, b1;
+
+    yuvToRgb (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (yuv_buffer)), r0, g0, b0);
+    yuvToRgb (_mm256_loadu_si256 (reinterpret_cast<const __m256i*> (yuv_buffer + 32)), r1, g1, b1);
+
+    Avx2Ops::store (rgb_buffer, packClipped (r0, r1), packClipped (g0, g1), packClipped (b0, b1));
+  }
+
+  return done;
+}
+
+/**
+ * Gathers the 8 groups of each vector instead of loading them one by one
+ */
+template <> unsigned
+yuvDownsampledRow<Avx2Ops> (const unsigned char* yuv_buffer, unsigned yuv_x_step, unsigned char* rgb_buffer, unsigned pixels)
+{
+  unsigned done = 0;
+
+  const int step = static_cast<int> (yuv_x_step);
+  const __m256i offsets = _mm256_setr_epi32 (0, step, 2 * step, 3 * step, 4 * step, 5 * step, 6 * step, 7 * step);
+
+  for (; done + 32 <= pixels; done += 32, yuv_buffer += 32 * yuv_x_step, rgb_buffer += 96)
+  {
+    __m256i r[4], g[4], b[4];
+
+    for (unsigned i = 0; i < 4; ++i)
+    {
+      __m256i uyvy = _mm256_i32gather_epi32 (reinterpret_cast<const int*> (yuv_buffer + 8 * i * yuv_x_step), offsets, 1);
+      __m256i y = _mm256_and_si256 (_mm256_srli_epi32 (uyvy, 8), _mm256_set1_epi32 (0xff));
+
+      chromaTerms (uyvy, r[i], g[i], b[i]);
+
+      r[i] = _mm256_add_epi32 (y, r[i]);
+      g[i] = _mm256_add_epi32 (y, g[i]);
+      b[i] = _mm256_add_epi32 (y, b[i]);
+    }
+
+    Avx2Ops::store (rgb_buffer, packClipped (r), packClipped (g), packClipped (b));
+  }
+
+  return done;
+}
+#endif
+
+#ifdef __SSE2__
+/**
+ * The kernels of one instruction set. Luma extraction and the depth
+ * conversions are memory bound and share the 128 bit versions
+ */
+template <class Ops, class NarrowOps = Ops>
+struct KernelTable
+{
+  static const openni_wrapper::simd::Kernels kernels;
+};
+
+template <class Ops, class NarrowOps>
+const openni_wrapper::simd::Kernels KernelTable<Ops, NarrowOps>::kernels =
+{
+  {
+    &debayerRows<Ops, openni_wrapper::ImageBayerGRBG::Bilinear>,
+    &debayerRows<Ops, openni_wrapper::ImageBayerGRBG::EdgeAware>,
+    &debayerRows<Ops, openni_wrapper::ImageBayerGRBG::EdgeAwareWeighted>
+  },
+  &yuvRow<Ops>,
+  &yuvDownsampledRow<Ops>,
+  &lumaRow<NarrowOps>,
+  &depthRawRow<NarrowOps>,
+  &depthRow<NarrowOps>,
+  &disparityRow<NarrowOps>
+};
+#endif
+
+} // namespace
+
+#endif /* OPENNI_SIMD_KERNELS_H_ */
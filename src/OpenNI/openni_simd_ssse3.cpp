@@ -0,0 +1,29 @@
+/*
+ * openni_simd_ssse3.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "openni_simd_kernels.h"
+
+namespace openni_wrapper
+{
+namespace simd
+{
+
+/**
+ * Built with -mssse3, only called once the CPU is known to support it
+ */
+const Kernels*
+getSsse3Kernels ()
+{
+#ifdef __SSSE3__
+  return &KernelTable<Ssse3Ops>::kernels;
+#else
+  return 0;
+#endif
+}
+
+} // namespace simd
+} // namespace openni_wrapper
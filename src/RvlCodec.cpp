@@ -0,0 +1,219 @@
+/*
+ * RvlCodec.cpp
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#include "RvlCodec.h"
+
+#include <cstring>
+
+namespace
+{
+    class NibbleWriter
+    {
+        public:
+            NibbleWriter(uint8_t * output)
+             : output(output),
+               start(output),
+               word(0),
+               count(0)
+            {}
+
+            inline void encode(uint32_t value)
+            {
+                do
+                {
+                    uint32_t nibble = value & 0x7;
+
+                    if(value >>= 3)
+                    {
+                        nibble |= 0x8;
+                    }
+
+                    word = (word << 4) | nibble;
+
+                    if(++count == 8)
+                    {
+                        memcpy(output, &word, sizeof(word));
+                        output += sizeof(word);
+                        word = 0;
+                        count = 0;
+                    }
+                } while(value);
+            }
+
+            int finish()
+            {
+                if(count)
+                {
+                    word <<= 4 * (8 - count);
+                    memcpy(output, &word, sizeof(word));
+                    output += sizeof(word);
+                }
+
+                return output - start;
+            }
+
+        private:
+            uint8_t * output;
+            uint8_t * start;
+            uint32_t word;
+            int count;
+    };
+
+    class NibbleReader
+    {
+        public:
+            NibbleReader(const uint8_t * input, int size)
+             : input(input),
+               end(input + (size & ~3)),
+               word(0),
+               count(0),
+               overrun(false)
+            {}
+
+            inline uint32_t decode()
+            {
+                uint32_t value = 0;
+                int shift = 0;
+
+                while(true)
+                {
+                    if(!count)
+                    {
+                        if(input == end)
+                        {
+                            overrun = true;
+                            return 0;
+                        }
+
+                        memcpy(&word, input, sizeof(word));
+                        input += sizeof(word);
+                        count = 8;
+                    }
+
+                    uint32_t nibble = word >> 28;
+
+                    word <<= 4;
+                    count--;
+
+                    value |= (nibble & 0x7) << shift;
+
+                    if(!(nibble & 0x8))
+                    {
+                        return value;
+                    }
+
+                    shift += 3;
+
+                    if(shift > 30)
+                    {
+                        overrun = true;
+                        return 0;
+                    }
+                }
+            }
+
+            bool failed() const
+            {
+                return overrun;
+            }
+
+        private:
+            const uint8_t * input;
+            const uint8_t * end;
+            uint32_t word;
+            int count;
+            bool overrun;
+    };
+}
+
+int RvlCodec::bound(int numPixels)
+{
+    /**
+     * A 16 bit delta zigzags to at most 17 bits, i.e. 6 nibbles, and the run
+     * lengths never cost more than 2 nibbles per pixel they cover. The
+     * slack covers the last partial word and a trailing pair of runs
+     */
+    return numPixels * 4 + 64;
+}
+
+int RvlCodec::encode(const uint16_t * input, int numPixels, uint8_t * output)
+{
+    NibbleWriter writer(output);
+
+    const uint16_t * end = input + numPixels;
+    int previous = 0;
+
+    while(input != end)
+    {
+        uint32_t zeros = 0;
+        uint32_t nonzeros = 0;
+
+        for(; input != end && !*input; input++, zeros++);
+
+        writer.encode(zeros);
+
+        for(const uint16_t * p = input; p != end && *p; p++, nonzeros++);
+
+        writer.encode(nonzeros);
+
+        for(uint32_t i = 0; i < nonzeros; i++)
+        {
+            int current = *input++;
+            int delta = current - previous;
+
+            writer.encode((uint32_t)((delta << 1) ^ (delta >> 31)));
+
+            previous = current;
+        }
+    }
+
+    return writer.finish();
+}
+
+bool RvlCodec::decode(const uint8_t * input, int size, uint16_t * output, int numPixels)
+{
+    NibbleReader reader(input, size);
+
+    uint16_t * end = output + numPixels;
+    int previous = 0;
+
+    while(output != end)
+    {
+        uint32_t zeros = reader.decode();
+
+        if(reader.failed() || zeros > (uint32_t)(end - output))
+        {
+            return false;
+        }
+
+        memset(output, 0, zeros * sizeof(uint16_t));
+        output += zeros;
+
+        uint32_t nonzeros = reader.decode();
+
+        if(reader.failed() || nonzeros > (uint32_t)(end - output))
+        {
+            return false;
+        }
+
+        for(uint32_t i = 0; i < nonzeros; i++)
+        {
+            uint32_t positive = reader.decode();
+            int delta = (int)(positive >> 1) ^ -(int)(positive & 1);
+
+            previous += delta;
+            *output++ = (uint16_t)previous;
+        }
+
+        if(reader.failed())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,40 @@
+/*
+ * RvlCodec.h
+ *
+ *  Created on: 17 Oct 2026
+ *      Author: thomas
+ */
+
+#ifndef RVLCODEC_H_
+#define RVLCODEC_H_
+
+#include <stdint.h>
+
+/**
+ * Lossless depth codec after Wilson, "Fast Lossless Depth Image
+ * Compression" (RVL). Runs of invalid (zero) pixels are run length coded
+ * and valid pixels are coded as zigzagged deltas from the previous valid
+ * pixel, all as variable length 3 bit + continuation nibbles packed into
+ * 32 bit words
+ */
+class RvlCodec
+{
+    public:
+        /**
+         * Worst case output size in bytes for numPixels input pixels
+         */
+        static int bound(int numPixels);
+
+        /**
+         * Returns the number of bytes written to output, which must hold at
+         * least bound(numPixels) bytes
+         */
+        static int encode(const uint16_t * input, int numPixels, uint8_t * output);
+
+        /**
+         * Returns false if input ends before numPixels pixels were decoded
+         */
+        static bool decode(const uint8_t * input, int size, uint16_t * output, int numPixels);
+};
+
+#endif /* RVLCODEC_H_ */
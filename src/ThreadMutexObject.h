@@ -87,6 +87,33 @@ class ThreadMutexObject
             return lastCopy;
         }
 
+        T waitForChange(T lastValue)
+        {
+            boost::mutex::scoped_lock lock(mutex);
+
+            while(object == lastValue)
+            {
+                signal.wait(mutex);
+            }
+
+            lastCopy = object;
+
+            lock.unlock();
+
+            return lastCopy;
+        }
+
+        void incrementAndNotifyAll()
+        {
+            boost::mutex::scoped_lock lock(mutex);
+
+            object++;
+
+            signal.notify_all();
+
+            lock.unlock();
+        }
+
         T getValueWait(int wait = 33000)
         {
             boost::this_thread::sleep(boost::posix_time::microseconds(wait));
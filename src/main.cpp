@@ -1,8 +1,271 @@
 #include "main.h"
 
+static void listCodecs()
+{
+    const std::vector<CodecInfo> & codecs = CodecRegistry::codecs();
+
+    for(size_t i = 0; i < codecs.size(); i++)
+    {
+        std::cout << boost::format("%s codec %s, levels %d-%d (default %d)")
+                     % (codecs[i].stream == DepthStream ? "depth" : "image")
+                     % codecs[i].name
+                     % codecs[i].minLevel
+                     % codecs[i].maxLevel
+                     % codecs[i].defaultLevel
+                     << std::endl;
+    }
+}
+
+/**
+ * Codecs are given as name or name:level, e.g. --depth-codec zlib:6
+ */
+static bool parseCodec(CodecStream stream, const std::string & arg, CodecId & codec, int & level)
+{
+    std::string name = arg.substr(0, arg.find(':'));
+
+    const CodecInfo * info = CodecRegistry::find(stream, name);
+
+    if(!info)
+    {
+        std::cout << boost::format("Unknown %s codec '%s'") % (stream == DepthStream ? "depth" : "image") % name << std::endl;
+        return false;
+    }
+
+    codec = info->id;
+    level = -1;
+
+    if(arg.find(':') != std::string::npos)
+    {
+        level = atoi(arg.substr(arg.find(':') + 1).c_str());
+
+        if(level < info->minLevel || level > info->maxLevel)
+        {
+            std::cout << boost::format("Level %d out of range for %s") % level % name << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Adaptive level bounds are given as min:max, e.g. --adaptive-image-levels 60:90
+ */
+static bool parseLevelBounds(const std::string & arg, int & minLevel, int & maxLevel)
+{
+    if(arg.find(':') == std::string::npos)
+    {
+        std::cout << boost::format("Level bounds '%s' should be min:max") % arg << std::endl;
+        return false;
+    }
+
+    minLevel = atoi(arg.substr(0, arg.find(':')).c_str());
+    maxLevel = atoi(arg.substr(arg.find(':') + 1).c_str());
+
+    if(minLevel > maxLevel)
+    {
+        std::cout << boost::format("Level bounds '%s' are the wrong way round") % arg << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool parseOptions(int argc, char ** argv, LoggerOptions & options)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if(arg == "--list-codecs")
+        {
+            listCodecs();
+            exit(0);
+        }
+
+        if(arg == "--adaptive")
+        {
+            options.adaptiveLevels = true;
+            continue;
+        }
+
+        if(arg == "--raw-bayer")
+        {
+            options.rawBayer = true;
+            continue;
+        }
+
+        if(arg == "--native-yuv")
+        {
+            options.nativeYuv = true;
+            continue;
+        }
+
+        if(arg == "--legacy-klg")
+        {
+            options.legacyKlg = true;
+            continue;
+        }
+
+        if(arg == "--direct-io")
+        {
+            options.directIo = true;
+            continue;
+        }
+
+        if(i + 1 >= argc || arg.substr(0, 2) != "--")
+        {
+            continue;
+        }
+
+        std::string value = argv[i + 1];
+
+        if(arg == "--depth-codec")
+        {
+            if(!parseCodec(DepthStream, value, options.depthCodec, options.depthLevel))
+            {
+                return false;
+            }
+        }
+        else if(arg == "--image-codec")
+        {
+            if(!parseCodec(ImageStream, value, options.imageCodec, options.imageLevel))
+            {
+                return false;
+            }
+        }
+        else if(arg == "--jpeg-subsampling")
+        {
+            if(value == "444")
+            {
+                options.jpegSubsampling = JpegEncoder::Subsample444;
+            }
+            else if(value == "422")
+            {
+                options.jpegSubsampling = JpegEncoder::Subsample422;
+            }
+            else if(value == "420")
+            {
+                options.jpegSubsampling = JpegEncoder::Subsample420;
+            }
+            else
+            {
+                std::cout << "JPEG subsampling must be 444, 422 or 420" << std::endl;
+                return false;
+            }
+        }
+        else if(arg == "--adaptive-depth-levels")
+        {
+            if(!parseLevelBounds(value, options.depthLevelMin, options.depthLevelMax))
+            {
+                return false;
+            }
+
+            options.adaptiveLevels = true;
+        }
+        else if(arg == "--adaptive-image-levels")
+        {
+            if(!parseLevelBounds(value, options.imageLevelMin, options.imageLevelMax))
+            {
+                return false;
+            }
+
+            options.adaptiveLevels = true;
+        }
+        else if(arg == "--encoder-threads")
+        {
+            options.encoderThreads = atoi(value.c_str());
+        }
+        else if(arg == "--frames-in-flight")
+        {
+            options.framesInFlight = atoi(value.c_str());
+        }
+        else if(arg == "--ring-capacity")
+        {
+            options.ringCapacity = atoi(value.c_str());
+        }
+        else if(arg == "--keyframe-interval")
+        {
+            options.keyframeInterval = atoi(value.c_str());
+        }
+        else if(arg == "--depth-stripes")
+        {
+            options.depthStripes = atoi(value.c_str());
+        }
+        else if(arg == "--image-threads")
+        {
+            options.imageThreads = atoi(value.c_str());
+        }
+        else if(arg == "--checkpoint-interval")
+        {
+            options.checkpointInterval = atoi(value.c_str());
+        }
+        else if(arg == "--write-block-mb")
+        {
+            int megabytes = atoi(value.c_str());
+
+            if(megabytes < 1 || megabytes > 256)
+            {
+                std::cout << "Write blocks must be 1 to 256 MB" << std::endl;
+                return false;
+            }
+
+            options.writeBlockSize = megabytes << 20;
+        }
+        else if(arg == "--write-backlog-mb")
+        {
+            options.writeBacklogSize = (int64_t)atoi(value.c_str()) << 20;
+        }
+        else if(arg == "--preallocate-mb")
+        {
+            options.preallocateSize = (int64_t)atoi(value.c_str()) << 20;
+        }
+        else
+        {
+            continue;
+        }
+
+        i++;
+    }
+
+    /**
+     * The mosaic is only worth keeping if it is kept exactly
+     */
+    if(options.rawBayer && options.imageCodec == CodecJpeg)
+    {
+        std::cout << "Raw Bayer capture needs a lossless image codec, using zlib" << std::endl;
+        options.imageCodec = CodecZlib;
+        options.imageLevel = -1;
+    }
+
+    if(options.encoderThreads < 1 ||
+       options.framesInFlight < 1 ||
+       options.ringCapacity <= options.framesInFlight ||
+       options.keyframeInterval < 0 ||
+       options.depthStripes < 1 ||
+       options.depthStripes > 480 ||
+       options.imageThreads < 1 ||
+       options.checkpointInterval < 0 ||
+       options.writeBacklogSize < 0 ||
+       options.preallocateSize < 0)
+    {
+        std::cout << "Invalid pipeline options, the ring capacity must exceed the frames in flight" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
 int main(int argc, char **argv)
 {
-    Logger * logger = new Logger;
+    LoggerOptions options;
+
+    if(!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+
+    Logger * logger = new Logger(options);
 
     QApplication app(argc, argv);
     MainWindow * window = new MainWindow(logger);
@@ -16,7 +279,7 @@ MainWindow::MainWindow(Logger * logger)
    depthImage(640, 480, QImage::Format_RGB888),
    rgbImage(640, 480, QImage::Format_RGB888),
    recording(false),
-   lastDrawn(-1)
+   lastDrawn(0)
 {
     this->setMaximumSize(1280, 600);
     this->setMinimumSize(1280, 600);
@@ -232,29 +495,65 @@ void MainWindow::quit()
 
 void MainWindow::timerCallback()
 {
-    int lastDepth = logger->latestDepthIndex.getValue();
+    /**
+     * The writer stops on its own when the disk fails it
+     */
+    if(recording && !logger->isWriting())
+    {
+        recordToggle();
+    }
 
-    if(lastDepth == -1)
+    const FrameRing & frameRing = logger->getFrameRing();
+
+    uint64_t lastDepth = frameRing.latest();
+
+    if(lastDepth == 0 || lastDepth == lastDrawn)
+    {
+        return;
+    }
+
+    int64_t frameTime, frameTag;
+
+    if(frameRing.read(lastDepth, &frameBuffer[0], frameTime, frameTag) != FrameRing::FrameOk)
     {
         return;
     }
 
-    int bufferIndex = lastDepth % 10;
+    /**
+     * Depth slots are tagged with the image ring sequence of their image
+     */
+    int64_t imageTime, imageTag;
 
-    if(bufferIndex == lastDrawn)
+    if(logger->getImageRing().read(frameTag, &frameBuffer[Logger::depthBytes], imageTime, imageTag) != FrameRing::FrameOk)
     {
         return;
     }
 
-    if(lastFrameTime == logger->frameBuffers[bufferIndex].second)
+    lastDrawn = lastDepth;
+
+    if(lastFrameTime == frameTime)
     {
         return;
     }
 
-    memcpy(&depthBuffer[0], logger->frameBuffers[bufferIndex].first.first, 640 * 480 * 2);
-    memcpy(rgbImage.bits(), logger->frameBuffers[bufferIndex].first.second, 640 * 480 * 3);
+    if(logger->getImageFormat() == KlgPixelBayerGrbg8)
+    {
+        cv::Mat1b bayer(480, 640, &frameBuffer[Logger::depthBytes]);
+        cv::Mat3b rgb(480, 640, (cv::Vec<unsigned char, 3> *)rgbImage.bits());
+        cv::cvtColor(bayer, rgb, CV_BayerGB2RGB);
+    }
+    else if(logger->getImageFormat() == KlgPixelYuv422)
+    {
+        cv::Mat uyvy(480, 640, CV_8UC2, &frameBuffer[Logger::depthBytes]);
+        cv::Mat3b rgb(480, 640, (cv::Vec<unsigned char, 3> *)rgbImage.bits());
+        cv::cvtColor(uyvy, rgb, CV_YUV2RGB_UYVY);
+    }
+    else
+    {
+        memcpy(rgbImage.bits(), &frameBuffer[Logger::depthBytes], 640 * 480 * 3);
+    }
 
-    cv::Mat1w depth(480, 640, (unsigned short *)&depthBuffer[0]);
+    cv::Mat1w depth(480, 640, (unsigned short *)&frameBuffer[0]);
     normalize(depth, tmp, 0, 255, cv::NORM_MINMAX, 0);
 
     cv::Mat3b depthImg(480, 640, (cv::Vec<unsigned char, 3> *)depthImage.bits());
@@ -264,7 +563,7 @@ void MainWindow::timerCallback()
     painter->setFont(QFont("Arial", 30));
     painter->drawText(10, 50, recording ? "Recording" : "Viewing");
 
-    frameStats.push_back(abs(logger->frameBuffers[bufferIndex].second - lastFrameTime));
+    frameStats.push_back(abs(frameTime - lastFrameTime));
 
     if(frameStats.size() > 15)
     {
@@ -289,7 +588,7 @@ void MainWindow::timerCallback()
     std::stringstream str;
     str << fps << "fps";
 
-    lastFrameTime = logger->frameBuffers[bufferIndex].second;
+    lastFrameTime = frameTime;
 
     painter->setFont(QFont("Arial", 24));
     painter->drawText(10, 455, QString::fromStdString(str.str()));
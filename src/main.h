@@ -67,13 +67,13 @@ class MainWindow : public QWidget
         QPushButton * browseButton;
         QPushButton * dateNameButton;
         QLabel * logFile;
-        unsigned short depthBuffer[640 * 480 * 2];
+        uint8_t frameBuffer[Logger::depthBytes + Logger::imageBytes];
         QLabel * depthLabel;
         QLabel * imageLabel;
         QTimer * timer;
         cv::Mat1b tmp;
         QPainter * painter;
-        int lastDrawn;
+        uint64_t lastDrawn;
 
         std::vector<int64_t> frameStats;
         int64_t lastFrameTime;